@@ -0,0 +1,166 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CG3Detector.hpp"
+#include "Trace.hpp"
+#include "inlines.hpp"
+#include <memory>
+#include <vector>
+
+#if defined(Q_OS_WIN)
+#define CG3_BINARY_NAME "vislcg3.exe"
+#else
+#define CG3_BINARY_NAME "vislcg3"
+#endif
+
+// Same patience queryCG3Version() has, but shared by all binaries being asked at once
+constexpr int PROBE_TIMEOUT_MS = 30000;
+
+CG3Detector::CG3Detector(QObject *parent)
+	: QThread(parent)
+	, paths(searchPaths())
+{
+}
+
+// Synchronous variant for when the user explicitly asks, e.g. from the options dialog
+QString CG3Detector::findLatest() {
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	auto latest = detect(searchPaths());
+	QApplication::restoreOverrideCursor();
+	return latest;
+}
+
+void CG3Detector::run() {
+	emit detected(detect(paths));
+}
+
+QStringList CG3Detector::searchPaths() {
+	QSettings settings;
+	QStringList paths;
+
+	if (settings.contains("cg3/binary")) {
+		paths.append(QFileInfo(settings.value("cg3/binary").toString()).dir().path());
+	}
+
+	#if defined(Q_OS_WIN)
+	paths.append(QCoreApplication::instance()->applicationDirPath());
+	paths.append(QCoreApplication::instance()->applicationDirPath() + "/cg3/win32");
+	#elif defined(Q_OS_MAC)
+	paths.append(QCoreApplication::instance()->applicationDirPath() + "/../Resources/CG-3");
+	#else
+	paths.append(QCoreApplication::instance()->applicationDirPath() + "/cg3/linux");
+	#endif
+
+	#if defined(Q_OS_WIN)
+	paths.append(QProcessEnvironment::systemEnvironment().value("PATH").split(';'));
+	#else
+	paths.append(QProcessEnvironment::systemEnvironment().value("PATH").split(':'));
+	paths.append("/usr/bin");
+	paths.append("/usr/local/bin");
+	paths.append("/opt/bin");
+	paths.append("/opt/local/bin");
+	paths.append(QDir::home().filePath("/bin"));
+	#endif
+
+	return paths;
+}
+
+QString CG3Detector::detect(const QStringList& paths) {
+	TRACE_SPAN("detect cg3");
+	QSettings settings;
+	auto cache = settings.value("cg3/detected").toMap();
+	QVariantMap seen;
+
+	struct Probe {
+		QString path;
+		QVariantList key;
+		std::unique_ptr<QProcess> process;
+	};
+	std::vector<Probe> probes;
+
+	QString latest;
+	size_t vlatest = 0;
+	auto consider = [&](const QString& path, size_t ver) {
+		if (ver > vlatest) {
+			latest = path;
+			vlatest = ver;
+		}
+	};
+
+	for (auto& path : paths) {
+		QDir cg3(path);
+		if (path.isEmpty() || !cg3.exists(CG3_BINARY_NAME)) {
+			continue;
+		}
+		QFileInfo exe(cg3.filePath(CG3_BINARY_NAME));
+		auto name = exe.canonicalFilePath();
+		if (!exe.isExecutable() || name.isEmpty() || seen.contains(name)) {
+			continue;
+		}
+
+		QVariantList key{exe.lastModified().toMSecsSinceEpoch(), exe.size()};
+		auto cached = cache.value(name).toList();
+		if (cached.size() == 3 && cached.mid(0, 2) == key) {
+			seen[name] = cached;
+			consider(exe.filePath(), cached[2].toULongLong());
+			continue;
+		}
+
+		seen[name] = QVariant();
+		Probe probe{exe.filePath(), key, std::make_unique<QProcess>()};
+		probe.process->setProcessChannelMode(QProcess::MergedChannels);
+		probe.process->start(exe.filePath(), QStringList() << "--version");
+		probes.push_back(std::move(probe));
+	}
+
+	// All probes run side by side, so this takes as long as the slowest binary rather than the sum of them
+	QElapsedTimer timer;
+	timer.start();
+	auto thread = QThread::currentThread();
+	for (auto& probe : probes) {
+		size_t ver = 0;
+		bool done = false;
+		while (!done && probe.process->state() != QProcess::NotRunning && timer.elapsed() < PROBE_TIMEOUT_MS && !thread->isInterruptionRequested()) {
+			done = probe.process->waitForFinished(100);
+		}
+		if (done || (probe.process->state() == QProcess::NotRunning && probe.process->exitStatus() == QProcess::NormalExit)) {
+			ver = parseCG3Version(probe.process->readAll());
+		}
+		else {
+			probe.process->kill();
+			probe.process->waitForFinished(1000);
+			if (thread->isInterruptionRequested()) {
+				// Don't cache a version we never got to see
+				seen.remove(QFileInfo(probe.path).canonicalFilePath());
+				continue;
+			}
+		}
+		auto name = QFileInfo(probe.path).canonicalFilePath();
+		seen[name] = QVariantList{probe.key[0], probe.key[1], static_cast<qulonglong>(ver)};
+		consider(probe.path, ver);
+	}
+
+	// Only what was found this time is kept, so binaries that went away drop out of the cache
+	if (seen != cache) {
+		settings.setValue("cg3/detected", seen);
+	}
+	return latest;
+}
@@ -0,0 +1,221 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DiagnosticsModel.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+
+// Beyond this many separate runs of changed rows, resetting beats telling the view about each one
+constexpr int MAX_DIFF_RUNS = 64;
+
+DiagnosticsModel::DiagnosticsModel(QObject *parent) :
+	QAbstractTableModel(parent),
+	sort_column(0),
+	sort_order(Qt::AscendingOrder),
+	icon_error(QApplication::style()->standardIcon(QStyle::SP_MessageBoxCritical)),
+	icon_warning(QApplication::style()->standardIcon(QStyle::SP_MessageBoxWarning))
+{
+}
+
+// A total order, with the sort column first, so two sets can be diffed by walking them side by side
+bool DiagnosticsModel::less(const Diagnostic& a_, const Diagnostic& b_) const {
+	const auto& a = (sort_order == Qt::AscendingOrder) ? a_ : b_;
+	const auto& b = (sort_order == Qt::AscendingOrder) ? b_ : a_;
+	if (sort_column == 1 && a.kind != b.kind) {
+		return a.kind < b.kind;
+	}
+	if (sort_column == 2) {
+		auto c = a.message.compare(b.message);
+		if (c) {
+			return c < 0;
+		}
+	}
+	if (a.line != b.line) {
+		return a.line < b.line;
+	}
+	if (a.kind != b.kind) {
+		return a.kind < b.kind;
+	}
+	return a.message < b.message;
+}
+
+void DiagnosticsModel::setDiagnostics(QVector<Diagnostic> next) {
+	TRACE_SPAN("diagnostics diff");
+	auto cmp = [this](const Diagnostic& a, const Diagnostic& b) {
+		return less(a, b);
+	};
+	std::stable_sort(next.begin(), next.end(), cmp);
+
+	// Count the runs of rows to remove or insert first, to know whether it's worth going row by row
+	int runs = 0;
+	for (int i=0, j=0, last=0 ; i<rows.size() || j<next.size() ; ) {
+		int step = 0;
+		if (i < rows.size() && j < next.size() && !less(rows[i], next[j]) && !less(next[j], rows[i])) {
+			++i;
+			++j;
+		}
+		else if (j >= next.size() || (i < rows.size() && less(rows[i], next[j]))) {
+			step = 1;
+			++i;
+		}
+		else {
+			step = 2;
+			++j;
+		}
+		if (step && step != last) {
+			++runs;
+		}
+		last = step;
+	}
+	if (runs == 0) {
+		return;
+	}
+	if (runs > MAX_DIFF_RUNS) {
+		beginResetModel();
+		rows.swap(next);
+		endResetModel();
+		return;
+	}
+
+	int row = 0, j = 0;
+	while (row < rows.size() || j < next.size()) {
+		if (row < rows.size() && j < next.size() && !less(rows[row], next[j]) && !less(next[j], rows[row])) {
+			++row;
+			++j;
+		}
+		else if (j >= next.size() || (row < rows.size() && less(rows[row], next[j]))) {
+			int end = row;
+			while (end < rows.size() && (j >= next.size() || less(rows[end], next[j]))) {
+				++end;
+			}
+			beginRemoveRows(QModelIndex(), row, end-1);
+			rows.remove(row, end - row);
+			endRemoveRows();
+		}
+		else {
+			int end = j;
+			while (end < next.size() && (row >= rows.size() || less(next[end], rows[row]))) {
+				++end;
+			}
+			beginInsertRows(QModelIndex(), row, row + end - j - 1);
+			rows.insert(row, end - j, Diagnostic());
+			std::copy(next.begin() + j, next.begin() + end, rows.begin() + row);
+			endInsertRows();
+			row += end - j;
+			j = end;
+		}
+	}
+}
+
+void DiagnosticsModel::clear() {
+	if (rows.isEmpty()) {
+		return;
+	}
+	beginResetModel();
+	rows.clear();
+	endResetModel();
+}
+
+int DiagnosticsModel::maxLine() const {
+	int rv = 0;
+	for (auto& d : rows) {
+		rv = std::max(rv, d.line);
+	}
+	return rv;
+}
+
+int DiagnosticsModel::rowCount(const QModelIndex& parent) const {
+	return parent.isValid() ? 0 : static_cast<int>(rows.size());
+}
+
+int DiagnosticsModel::columnCount(const QModelIndex& parent) const {
+	return parent.isValid() ? 0 : 3;
+}
+
+QVariant DiagnosticsModel::data(const QModelIndex& index, int role) const {
+	if (!index.isValid() || index.row() >= rows.size()) {
+		return QVariant();
+	}
+	const auto& d = rows[index.row()];
+	if (role == Qt::DisplayRole) {
+		switch (index.column()) {
+		case 0:
+			return d.line;
+		case 1:
+			return (d.kind == Diagnostic::KIND_ERROR) ? tr("Error") : tr("Warning");
+		case 2:
+			return d.message;
+		}
+	}
+	else if (role == Qt::DecorationRole && index.column() == 1) {
+		return (d.kind == Diagnostic::KIND_ERROR) ? icon_error : icon_warning;
+	}
+	else if (role == Qt::ToolTipRole && index.column() == 2) {
+		return d.message;
+	}
+	return QVariant();
+}
+
+QVariant DiagnosticsModel::headerData(int section, Qt::Orientation orientation, int role) const {
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+		return QVariant();
+	}
+	switch (section) {
+	case 0:
+		return tr("Line");
+	case 1:
+		return tr("Type");
+	case 2:
+		return tr("Message");
+	}
+	return QVariant();
+}
+
+void DiagnosticsModel::sort(int column, Qt::SortOrder order) {
+	if (column == sort_column && order == sort_order) {
+		return;
+	}
+	sort_column = column;
+	sort_order = order;
+	emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+	QVector<int> idx(rows.size());
+	for (int i=0 ; i<idx.size() ; ++i) {
+		idx[i] = i;
+	}
+	std::stable_sort(idx.begin(), idx.end(), [this](int a, int b) {
+		return less(rows[a], rows[b]);
+	});
+	// Selections and the current index are persistent indexes, and follow their rows to where they were sorted to
+	QVector<Diagnostic> sorted(rows.size());
+	QVector<int> moved(rows.size());
+	for (int i=0 ; i<idx.size() ; ++i) {
+		sorted[i] = rows[idx[i]];
+		moved[idx[i]] = i;
+	}
+	rows.swap(sorted);
+	auto from = persistentIndexList();
+	QModelIndexList to;
+	for (auto& i : from) {
+		to << index(moved.value(i.row(), i.row()), i.column());
+	}
+	changePersistentIndexList(from, to);
+	emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
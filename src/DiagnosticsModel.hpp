@@ -0,0 +1,67 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef DIAGNOSTICSMODEL_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define DIAGNOSTICSMODEL_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtWidgets>
+
+struct Diagnostic {
+	enum Kind {
+		KIND_ERROR,
+		KIND_WARNING,
+	};
+
+	int line = 0;
+	Kind kind = KIND_ERROR;
+	QString message;
+};
+
+// The errors table, straight over a vector of diagnostics kept in the view's sort order.
+// A new set of diagnostics is applied as row inserts and removes against the old one, so rows that are still there
+// keep their place, selection and scroll position. Too many changes at once and it's cheaper to just reset.
+class DiagnosticsModel : public QAbstractTableModel {
+	Q_OBJECT
+
+public:
+	explicit DiagnosticsModel(QObject *parent = nullptr);
+
+	void setDiagnostics(QVector<Diagnostic> next);
+	void clear();
+	int maxLine() const;
+
+	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+	bool less(const Diagnostic& a, const Diagnostic& b) const;
+
+	QVector<Diagnostic> rows;
+	int sort_column;
+	Qt::SortOrder sort_order;
+	QIcon icon_error, icon_warning;
+};
+
+#endif // DIAGNOSTICSMODEL_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -0,0 +1,274 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EditJournal.hpp"
+#include <algorithm>
+
+// Unwritten changes are lost in a crash for at most this long
+constexpr int FLUSH_MS = 500;
+// A compaction waits for the typing to pause for this long
+constexpr int COMPACT_IDLE_MS = 3000;
+constexpr int COMPACT_DELTAS = 2000;
+
+static QString journalDir() {
+	return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("journal");
+}
+
+// Records are a header line, with the payload size as last field, followed by that many bytes of UTF-8:
+//   N <size>                     the grammar's file name, empty for untitled
+//   S <size>                     the whole text
+//   D <pos> <removed> <size>     replace removed characters at pos with the payload
+EditJournal::EditJournal(QTextDocument *doc, QObject *parent) :
+	QObject(parent),
+	doc(doc),
+	length(0),
+	deltas(0),
+	revision(-1),
+	dirty(false),
+	paused(false)
+{
+	static int serial = 0;
+	QDir().mkpath(journalDir());
+	auto path = QDir(journalDir()).filePath(QString("%1-%2.cg3j").arg(QCoreApplication::applicationPid()).arg(++serial));
+
+	// The lock tells other instances this journal has a live owner
+	lock.reset(new QLockFile(path + ".lock"));
+	lock->setStaleLockTime(0);
+	lock->tryLock(0);
+
+	file.setFileName(path);
+	file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+	file.write(nameRecord());
+	file.flush();
+
+	flush_timer.setSingleShot(true);
+	flush_timer.setInterval(FLUSH_MS);
+	connect(&flush_timer, SIGNAL(timeout()), this, SLOT(flush()));
+	compact_timer.setSingleShot(true);
+	compact_timer.setInterval(COMPACT_IDLE_MS);
+	connect(&compact_timer, SIGNAL(timeout()), this, SLOT(compact()));
+	connect(doc, SIGNAL(contentsChange(int,int,int)), this, SLOT(document_contentsChange(int,int,int)));
+}
+
+EditJournal::~EditJournal() {
+	flush();
+}
+
+void EditJournal::setFileName(const QString& filename) {
+	if (name == filename) {
+		return;
+	}
+	name = filename;
+	buffer.append(nameRecord());
+	flush_timer.start();
+}
+
+// While paused, changes are not recorded; the owner calls markClean() or checkpoint() afterwards to say what the document is
+void EditJournal::setPaused(bool p) {
+	paused = p;
+}
+
+// The document matches the file on disk, so there is nothing to recover and the journal starts over
+void EditJournal::markClean() {
+	buffer.clear();
+	flush_timer.stop();
+	compact_timer.stop();
+	file.resize(0);
+	file.seek(0);
+	file.write(nameRecord());
+	file.flush();
+	dirty = false;
+	deltas = 0;
+}
+
+// Records the whole document now, for when it is modified without a change of content the journal would see
+void EditJournal::checkpoint() {
+	buffer.append(snapshotRecord());
+	flush();
+}
+
+// For a clean shutdown of the owning window
+void EditJournal::discard() {
+	disconnect(doc, nullptr, this, nullptr);
+	flush_timer.stop();
+	compact_timer.stop();
+	buffer.clear();
+	file.close();
+	file.remove();
+	lock->unlock();
+}
+
+QByteArray EditJournal::nameRecord() const {
+	auto n = name.toUtf8();
+	return QByteArray("N ") + QByteArray::number(n.size()) + '\n' + n;
+}
+
+QByteArray EditJournal::snapshotRecord() {
+	auto text = doc->toPlainText().toUtf8();
+	length = doc->characterCount() - 1;
+	revision = doc->revision();
+	dirty = true;
+	deltas = 0;
+	return QByteArray("S ") + QByteArray::number(text.size()) + '\n' + text;
+}
+
+void EditJournal::append(const QByteArray& head, const QByteArray& payload) {
+	buffer.append(head);
+	buffer.append(payload);
+	if (!flush_timer.isActive()) {
+		flush_timer.start();
+	}
+}
+
+void EditJournal::document_contentsChange(int pos, int removed, int added) {
+	// An unmodified document is on disk already
+	if (paused || !doc->isModified()) {
+		return;
+	}
+	// Highlighting reports format changes as the block's text replacing itself, without a new revision.
+	// Journaling those would rewrite the whole document a block at a time on every rehighlight.
+	if (dirty && removed == added && doc->characterCount() - 1 == length && doc->revision() == revision) {
+		return;
+	}
+	if (!dirty) {
+		buffer.append(snapshotRecord());
+		flush_timer.start();
+		return;
+	}
+
+	// Counts can include the document's final paragraph separator, which isn't part of the text
+	auto now = doc->characterCount() - 1;
+	removed = std::min(removed, length - pos);
+	added = std::min(added, now - pos);
+	if (pos < 0 || removed < 0 || added < 0 || length - removed + added != now) {
+		buffer.append(snapshotRecord());
+		flush_timer.start();
+		return;
+	}
+
+	QByteArray text;
+	if (added) {
+		QTextCursor cur(doc);
+		cur.setPosition(pos);
+		cur.setPosition(pos + added, QTextCursor::KeepAnchor);
+		text = cur.selectedText().replace(QChar::ParagraphSeparator, '\n').toUtf8();
+	}
+	append(QByteArray("D ") + QByteArray::number(pos) + ' ' + QByteArray::number(removed) + ' ' + QByteArray::number(text.size()) + '\n', text);
+	length = now;
+	revision = doc->revision();
+
+	if (++deltas >= COMPACT_DELTAS || file.size() > 2 * qint64(length) + (1 << 20)) {
+		compact_timer.start();
+	}
+}
+
+void EditJournal::flush() {
+	if (buffer.isEmpty() || !file.isOpen()) {
+		return;
+	}
+	file.write(buffer);
+	file.flush();
+	buffer.clear();
+}
+
+// Replaces the journal with a single snapshot, atomically so a crash meanwhile still leaves the old one
+void EditJournal::compact() {
+	if (!dirty || !file.isOpen()) {
+		return;
+	}
+	QSaveFile out(file.fileName());
+	if (!out.open(QIODevice::WriteOnly)) {
+		return;
+	}
+	buffer.clear();
+	out.write(nameRecord());
+	out.write(snapshotRecord());
+	if (!out.commit()) {
+		return;
+	}
+	file.close();
+	file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+// Journals left behind by instances that are no longer running
+QStringList EditJournal::orphans() {
+	QStringList rv;
+	QDir dir(journalDir());
+	for (auto& fi : dir.entryInfoList(QStringList() << "*.cg3j", QDir::Files, QDir::Time)) {
+		QLockFile lock(fi.filePath() + ".lock");
+		lock.setStaleLockTime(0);
+		if (lock.tryLock(0)) {
+			rv << fi.filePath();
+		}
+	}
+	return rv;
+}
+
+// Rebuilds the text as of the last record that made it to disk. Returns false if there are no unsaved changes in it.
+bool EditJournal::replay(const QString& journal, QString& filename, QString& text) {
+	QFile f(journal);
+	if (!f.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	auto data = f.readAll();
+
+	bool any = false;
+	for (int i=0 ; i<data.size() ; ) {
+		auto nl = data.indexOf('\n', i);
+		if (nl < 0) {
+			break;
+		}
+		auto head = data.mid(i, nl - i).split(' ');
+		bool ok = false;
+		auto n = head.back().toInt(&ok);
+		// A record torn by the crash ends the replay
+		if (!ok || n < 0 || nl + 1 + n > data.size()) {
+			break;
+		}
+		auto payload = QString::fromUtf8(data.constData() + nl + 1, n);
+		i = nl + 1 + n;
+
+		if (head[0] == "N" && head.size() == 2) {
+			filename = payload;
+		}
+		else if (head[0] == "S" && head.size() == 2) {
+			text = payload;
+			any = true;
+		}
+		else if (head[0] == "D" && head.size() == 4 && any) {
+			auto pos = head[1].toInt();
+			auto removed = head[2].toInt();
+			if (pos < 0 || removed < 0 || pos + removed > text.size()) {
+				break;
+			}
+			text.replace(pos, removed, payload);
+		}
+		else {
+			break;
+		}
+	}
+	return any;
+}
+
+void EditJournal::remove(const QString& journal) {
+	QFile::remove(journal);
+	QFile::remove(journal + ".lock");
+}
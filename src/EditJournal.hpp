@@ -0,0 +1,68 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef EDITJOURNAL_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define EDITJOURNAL_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtWidgets>
+
+// Append-only record of the unsaved edits to one document, so they can be recovered after a crash.
+// Each change is logged as a small delta, with a full snapshot when the document first goes from saved to modified
+// and whenever the deltas have grown big enough that a fresh snapshot is cheaper to replay.
+class EditJournal : public QObject {
+	Q_OBJECT
+
+public:
+	explicit EditJournal(QTextDocument *doc, QObject *parent = nullptr);
+	~EditJournal();
+
+	void setFileName(const QString&);
+	void setPaused(bool);
+	void markClean();
+	void checkpoint();
+	void discard();
+
+	static QStringList orphans();
+	static bool replay(const QString& journal, QString& filename, QString& text);
+	static void remove(const QString& journal);
+
+private slots:
+	void document_contentsChange(int, int, int);
+	void flush();
+	void compact();
+
+private:
+	void append(const QByteArray& head, const QByteArray& payload);
+	QByteArray nameRecord() const;
+	QByteArray snapshotRecord();
+
+	QTextDocument *doc;
+	QString name;
+	QFile file;
+	QScopedPointer<QLockFile> lock;
+	QByteArray buffer;
+	QTimer flush_timer, compact_timer;
+	int length, deltas, revision;
+	bool dirty, paused;
+};
+
+#endif // EDITJOURNAL_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -0,0 +1,108 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EditorInstance.hpp"
+#include "GrammarEditor.hpp"
+#include "inlines.hpp"
+
+EditorInstance::EditorInstance(QObject *parent) :
+	QObject(parent)
+{
+	connect(&server, SIGNAL(newConnection()), this, SLOT(server_newConnection()));
+}
+
+// Fails if another editor is already running for this user
+bool EditorInstance::listen() {
+	return listenLocal(server, editorServerName());
+}
+
+// Asks a running editor to open the files, or an empty window if there are none.
+// Returns false unless every request was answered, in which case this process should become the editor,
+// and args is left with just the files that weren't answered for.
+bool EditorInstance::forward(QStringList& args) {
+	QLocalSocket sock;
+	sock.connectToServer(editorServerName());
+	if (!sock.waitForConnected(500)) {
+		return false;
+	}
+
+	QStringList lines;
+	for (auto& arg : args) {
+		lines << QString("open\t%1\n").arg(QFileInfo(arg).absoluteFilePath());
+	}
+	if (lines.isEmpty()) {
+		lines << "new\n";
+	}
+	sock.write(lines.join("").toUtf8());
+	if (!sock.waitForBytesWritten(2000)) {
+		return false;
+	}
+
+	// Answers come in the order the requests were sent
+	for (int answered = 0 ; answered < lines.size() ; ) {
+		if (!sock.canReadLine() && !sock.waitForReadyRead(5000)) {
+			args = args.mid(answered);
+			return false;
+		}
+		while (sock.canReadLine()) {
+			sock.readLine();
+			++answered;
+		}
+	}
+	return true;
+}
+
+void EditorInstance::openWindow(const QString& filename) {
+	auto w = new GrammarEditor;
+	w->setAttribute(Qt::WA_DeleteOnClose);
+	w->show();
+	if (!filename.isEmpty()) {
+		w->open(filename);
+	}
+	w->raise();
+	w->activateWindow();
+}
+
+void EditorInstance::server_newConnection() {
+	while (auto sock = server.nextPendingConnection()) {
+		connect(sock, SIGNAL(readyRead()), this, SLOT(socket_readyRead()));
+		connect(sock, SIGNAL(disconnected()), sock, SLOT(deleteLater()));
+	}
+}
+
+// One request per line: "open\t<absolute path>" or "new", each answered with "ok" once the window is up
+void EditorInstance::socket_readyRead() {
+	auto sock = qobject_cast<QLocalSocket*>(sender());
+	while (sock && sock->canReadLine()) {
+		auto ls = QString::fromUtf8(sock->readLine()).trimmed().split('\t');
+		if (ls.at(0) == "open" && ls.size() >= 2) {
+			openWindow(ls.at(1));
+			sock->write("ok\n");
+		}
+		else if (ls.at(0) == "new") {
+			openWindow();
+			sock->write("ok\n");
+		}
+		else {
+			sock->write("error\tUnknown request\n");
+		}
+	}
+}
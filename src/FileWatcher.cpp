@@ -0,0 +1,152 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FileWatcher.hpp"
+#include <algorithm>
+
+// Editors and tools tend to touch a file several times in one save
+constexpr int COALESCE_MS = 200;
+
+// Owned by the application, so the watcher and its thread are torn down while there is still an event loop,
+// rather than by static destruction after the application object is gone. Only windows use it, and they go first.
+FileWatcher& FileWatcher::instance() {
+	static auto fw = new FileWatcher(qApp);
+	return *fw;
+}
+
+FileWatcher::FileWatcher(QObject *parent) :
+	QObject(parent)
+{
+	coalesce_timer.setSingleShot(true);
+	coalesce_timer.setInterval(COALESCE_MS);
+	connect(&coalesce_timer, SIGNAL(timeout()), this, SLOT(emitChanged()));
+	connect(&watcher, SIGNAL(fileChanged(QString)), this, SLOT(watcher_fileChanged(QString)));
+	connect(&watcher, SIGNAL(directoryChanged(QString)), this, SLOT(watcher_directoryChanged(QString)));
+}
+
+// Replaces what the owner watches under this role. Paths are made absolute, so compare against absoluteFilePath().
+void FileWatcher::setPaths(QObject *owner, const QString& role, const QStringList& paths) {
+	QStringList abs;
+	for (auto& p : paths) {
+		if (!p.isEmpty()) {
+			abs << QFileInfo(p).absoluteFilePath();
+		}
+	}
+	abs.removeDuplicates();
+
+	if (!owners.contains(owner)) {
+		connect(owner, SIGNAL(destroyed(QObject*)), this, SLOT(owner_destroyed(QObject*)));
+	}
+	auto& old = owners[owner][role];
+	for (auto& p : abs) {
+		if (!old.contains(p)) {
+			add(p);
+		}
+	}
+	for (auto& p : old) {
+		if (!abs.contains(p)) {
+			release(p);
+		}
+	}
+	old = abs;
+}
+
+QStringList FileWatcher::paths(QObject *owner, const QString& role) const {
+	return owners.value(owner).value(role);
+}
+
+void FileWatcher::add(const QString& path) {
+	if (refs[path]++) {
+		return;
+	}
+	if (QFileInfo::exists(path)) {
+		watcher.addPath(path);
+	}
+}
+
+void FileWatcher::release(const QString& path) {
+	if (--refs[path] > 0) {
+		return;
+	}
+	refs.remove(path);
+	watcher.removePath(path);
+	if (missing.remove(path)) {
+		auto dir = QFileInfo(path).absolutePath();
+		bool others = std::any_of(missing.begin(), missing.end(), [&](const QString& m) { return QFileInfo(m).absolutePath() == dir; });
+		if (!others) {
+			watcher.removePath(dir);
+		}
+	}
+}
+
+void FileWatcher::watcher_fileChanged(const QString& path) {
+	pending.insert(path);
+	coalesce_timer.start();
+
+	// A file replaced by a rename is dropped by the watcher, so watch it anew, or its directory until it's back
+	if (!watcher.files().contains(path)) {
+		if (QFileInfo::exists(path)) {
+			watcher.addPath(path);
+		}
+		else {
+			missing.insert(path);
+			watcher.addPath(QFileInfo(path).absolutePath());
+		}
+	}
+}
+
+void FileWatcher::watcher_directoryChanged(const QString& dir) {
+	bool others = false;
+	for (auto it = missing.begin() ; it != missing.end() ; ) {
+		if (QFileInfo(*it).absolutePath() != dir) {
+			++it;
+			continue;
+		}
+		if (QFileInfo::exists(*it)) {
+			watcher.addPath(*it);
+			pending.insert(*it);
+			coalesce_timer.start();
+			it = missing.erase(it);
+		}
+		else {
+			others = true;
+			++it;
+		}
+	}
+	if (!others) {
+		watcher.removePath(dir);
+	}
+}
+
+void FileWatcher::owner_destroyed(QObject *owner) {
+	for (auto& ps : owners.value(owner)) {
+		for (auto& p : ps) {
+			release(p);
+		}
+	}
+	owners.remove(owner);
+}
+
+void FileWatcher::emitChanged() {
+	auto changed = pending.values();
+	pending.clear();
+	emit filesChanged(changed);
+}
@@ -0,0 +1,62 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef FILEWATCHER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define FILEWATCHER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+
+// One QFileSystemWatcher shared by all windows. Each window says which files it cares about, by role,
+// and everyone gets told about changes in batches, once things have been quiet for a moment.
+// Files replaced by a rename, as most editors and our own saves do, are picked up again when they reappear.
+class FileWatcher : public QObject {
+	Q_OBJECT
+
+public:
+	static FileWatcher& instance();
+
+	void setPaths(QObject *owner, const QString& role, const QStringList& paths);
+	QStringList paths(QObject *owner, const QString& role) const;
+
+signals:
+	void filesChanged(const QStringList&);
+
+private slots:
+	void watcher_fileChanged(const QString&);
+	void watcher_directoryChanged(const QString&);
+	void owner_destroyed(QObject*);
+	void emitChanged();
+
+private:
+	explicit FileWatcher(QObject *parent);
+	void add(const QString&);
+	void release(const QString&);
+
+	QFileSystemWatcher watcher;
+	QHash<QObject*, QHash<QString,QStringList>> owners;
+	QHash<QString,int> refs;
+	QSet<QString> missing;
+	QSet<QString> pending;
+	QTimer coalesce_timer;
+};
+
+#endif // FILEWATCHER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
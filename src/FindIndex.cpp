@@ -0,0 +1,165 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FindIndex.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+
+FindIndex::FindIndex(QObject *parent) :
+	QThread(parent),
+	stopping(false),
+	fresh(false),
+	done(0)
+{
+}
+
+FindIndex::~FindIndex() {
+	{
+		QMutexLocker lock(&mutex);
+		stopping = true;
+		queue.clear();
+		wake.wakeAll();
+	}
+	wait();
+}
+
+// Starts over with a new pattern or text, as from QTextDocument::toRawText(), so lines split exactly where blocks do.
+// Edits still waiting to be applied to the old text are moot.
+void FindIndex::reset(const QRegularExpression& pattern, const QString& snapshot, int generation) {
+	QMutexLocker lock(&mutex);
+	rx = pattern;
+	text = snapshot;
+	fresh = true;
+	queue.clear();
+	queue.enqueue(Request{0, 0, QStringList(), generation});
+	wake.wakeAll();
+	if (!isRunning()) {
+		start(QThread::LowPriority);
+	}
+}
+
+// Replaces the lines [first, first+removed) of the text last indexed with the given lines
+void FindIndex::splice(int first, int removed, const QStringList& ls, int generation) {
+	QMutexLocker lock(&mutex);
+	queue.enqueue(Request{first, removed, ls, generation});
+	wake.wakeAll();
+	if (!isRunning()) {
+		start(QThread::LowPriority);
+	}
+}
+
+void FindIndex::clear() {
+	QMutexLocker lock(&mutex);
+	rx = QRegularExpression();
+	text.clear();
+	fresh = true;
+	queue.clear();
+	queue.enqueue(Request{0, 0, QStringList(), 0});
+	wake.wakeAll();
+	if (!isRunning()) {
+		start(QThread::LowPriority);
+	}
+}
+
+QVector<FindMatch> FindIndex::matches(int *generation) const {
+	QMutexLocker lock(&mutex);
+	if (generation) {
+		*generation = done;
+	}
+	return results;
+}
+
+QVector<QPair<int,int>> FindIndex::search(const QString& line) const {
+	QVector<QPair<int,int>> rv;
+	if (active.pattern().isEmpty() || !active.isValid()) {
+		return rv;
+	}
+	auto it = active.globalMatch(line);
+	while (it.hasNext()) {
+		auto m = it.next();
+		// Empty matches aren't highlighted, and jumping to one would never move on
+		if (m.capturedLength(0) == 0) {
+			continue;
+		}
+		rv.append(qMakePair(static_cast<int>(m.capturedStart(0)), static_cast<int>(m.capturedLength(0))));
+	}
+	return rv;
+}
+
+void FindIndex::run() {
+	QMutexLocker lock(&mutex);
+	forever {
+		while (queue.isEmpty() && !stopping) {
+			wake.wait(&mutex);
+		}
+		if (stopping) {
+			break;
+		}
+
+		// Everything queued so far is applied before the results are published, as only the newest state matters
+		int generation = 0;
+		while (!queue.isEmpty() && !stopping) {
+			auto r = queue.dequeue();
+			generation = r.generation;
+			if (fresh) {
+				fresh = false;
+				active = rx;
+				auto snapshot = text;
+				text.clear();
+				lock.unlock();
+				TRACE_SPAN("index matches");
+				lines.clear();
+				for (auto& line : snapshot.split(QChar::ParagraphSeparator)) {
+					lines.append(search(line));
+				}
+				lock.relock();
+				continue;
+			}
+			lock.unlock();
+			QVector<QVector<QPair<int,int>>> found;
+			for (auto& line : r.lines) {
+				found.append(search(line));
+			}
+			auto first = std::min(std::max(r.first, 0), static_cast<int>(lines.size()));
+			auto removed = std::min(std::max(r.removed, 0), static_cast<int>(lines.size()) - first);
+			lines.remove(first, removed);
+			for (int i=0 ; i<found.size() ; ++i) {
+				lines.insert(first + i, found[i]);
+			}
+			lock.relock();
+		}
+		if (stopping) {
+			break;
+		}
+
+		lock.unlock();
+		QVector<FindMatch> flat;
+		for (int i=0 ; i<lines.size() ; ++i) {
+			for (auto& m : lines[i]) {
+				flat.append(FindMatch{i, m.first, m.second});
+			}
+		}
+		lock.relock();
+		results.swap(flat);
+		done = generation;
+		emit indexed(generation);
+	}
+}
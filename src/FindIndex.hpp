@@ -0,0 +1,77 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef FINDINDEX_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define FINDINDEX_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+
+struct FindMatch {
+	int line = 0;
+	int column = 0;
+	int length = 0;
+};
+
+// Keeps the positions of all matches of the find pattern on its own thread. It starts from a snapshot of the whole text,
+// after which only the lines that were edited are searched again. Each request carries a generation,
+// so the editor can tell whether the index it's looking at is up to date with the document.
+class FindIndex : public QThread {
+	Q_OBJECT
+
+public:
+	explicit FindIndex(QObject *parent = nullptr);
+	~FindIndex();
+
+	void reset(const QRegularExpression& rx, const QString& text, int generation);
+	void splice(int first, int removed, const QStringList& lines, int generation);
+	void clear();
+	QVector<FindMatch> matches(int *generation = nullptr) const;
+
+signals:
+	void indexed(int);
+
+protected:
+	void run() override;
+
+private:
+	struct Request {
+		int first, removed;
+		QStringList lines;
+		int generation;
+	};
+	QVector<QPair<int,int>> search(const QString& line) const;
+
+	mutable QMutex mutex;
+	QWaitCondition wake;
+	QQueue<Request> queue;
+	QRegularExpression rx;
+	QString text;
+	bool stopping, fresh;
+
+	// Only touched from the indexing thread, apart from the results
+	QRegularExpression active;
+	QVector<QVector<QPair<int,int>>> lines;
+	QVector<FindMatch> results;
+	int done;
+};
+
+#endif // FINDINDEX_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -0,0 +1,161 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GrammarEdit.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+
+// Room for the markers left of the numbers, and breathing space on either side
+constexpr int GUTTER_MARK = 6;
+constexpr int GUTTER_PAD = 4;
+
+LineGutter::LineGutter(GrammarEdit *edit) :
+	QWidget(edit),
+	edit(edit)
+{
+}
+
+QSize LineGutter::sizeHint() const {
+	return QSize(edit->gutterWidth(), 0);
+}
+
+void LineGutter::paintEvent(QPaintEvent *event) {
+	edit->paintGutter(event);
+}
+
+GrammarEdit::GrammarEdit(QWidget *parent) :
+	QPlainTextEdit(parent),
+	gutter(new LineGutter(this))
+{
+	connect(this, SIGNAL(blockCountChanged(int)), this, SLOT(updateGutterWidth()));
+	connect(this, SIGNAL(updateRequest(QRect,int)), this, SLOT(updateGutter(QRect,int)));
+	updateGutterWidth();
+}
+
+// Replaces all markers of one kind; lines are block numbers
+void GrammarEdit::setMarks(Mark kind, const QVector<int>& lines) {
+	for (auto it = marks.begin() ; it != marks.end() ; ) {
+		it.value() &= ~kind;
+		if (it.value() == 0) {
+			it = marks.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	for (auto line : lines) {
+		marks[line] |= kind;
+	}
+	gutter->update();
+}
+
+void GrammarEdit::clearMarks(Mark kind) {
+	setMarks(kind, QVector<int>());
+}
+
+int GrammarEdit::gutterWidth() const {
+	int digits = 1;
+	for (int max = std::max(1, blockCount()) ; max >= 10 ; max /= 10) {
+		++digits;
+	}
+	int digit = fontMetrics().horizontalAdvance(QLatin1Char('9'));
+	return GUTTER_MARK + GUTTER_PAD*2 + digit*digits;
+}
+
+void GrammarEdit::updateGutterWidth() {
+	setViewportMargins(gutterWidth(), 0, 0, 0);
+	auto cr = contentsRect();
+	gutter->setGeometry(QRect(cr.left(), cr.top(), gutterWidth(), cr.height()));
+}
+
+void GrammarEdit::updateGutter(const QRect& rect, int dy) {
+	if (dy) {
+		gutter->scroll(0, dy);
+	}
+	else {
+		gutter->update(0, rect.y(), gutter->width(), rect.height());
+	}
+	if (rect.contains(viewport()->rect())) {
+		updateGutterWidth();
+	}
+}
+
+void GrammarEdit::resizeEvent(QResizeEvent *event) {
+	QPlainTextEdit::resizeEvent(event);
+	updateGutterWidth();
+}
+
+// Zooming changes the font, and with it how wide the numbers are
+void GrammarEdit::changeEvent(QEvent *event) {
+	QPlainTextEdit::changeEvent(event);
+	if (event->type() == QEvent::FontChange) {
+		updateGutterWidth();
+	}
+}
+
+// Only the blocks that intersect the exposed area are visited, and their markers are found by looking up
+// the first visible line in the ordered map and walking forward from there
+void GrammarEdit::paintGutter(QPaintEvent *event) {
+	TRACE_SPAN("paint gutter");
+	QPainter painter(gutter);
+	painter.fillRect(event->rect(), palette().window());
+
+	auto block = firstVisibleBlock();
+	int line = block.blockNumber();
+	int top = qRound(blockBoundingGeometry(block).translated(contentOffset()).top());
+	int bottom = top + qRound(blockBoundingRect(block).height());
+	auto mark = marks.lowerBound(line);
+	int width = gutter->width();
+	int height = fontMetrics().height();
+
+	painter.setFont(font());
+	while (block.isValid() && top <= event->rect().bottom()) {
+		if (block.isVisible() && bottom >= event->rect().top()) {
+			painter.setPen(line == textCursor().blockNumber() ? palette().color(QPalette::WindowText) : palette().color(QPalette::Disabled, QPalette::WindowText));
+			painter.drawText(0, top, width - GUTTER_PAD, height, Qt::AlignRight, QString::number(line + 1));
+
+			while (mark != marks.end() && mark.key() < line) {
+				++mark;
+			}
+			if (mark != marks.end() && mark.key() == line) {
+				// The most severe marker wins the full height, a find hit keeps a sliver beside it
+				QColor color;
+				if (mark.value() & MARK_ERROR) {
+					color = Qt::red;
+				}
+				else if (mark.value() & MARK_WARNING) {
+					color = QColor(Qt::blue).lighter(150);
+				}
+				if (color.isValid()) {
+					painter.fillRect(GUTTER_PAD/2, top, GUTTER_MARK - 2, height, color);
+				}
+				if (mark.value() & MARK_HIT) {
+					painter.fillRect(GUTTER_PAD/2 + GUTTER_MARK - 2, top, 2, height, QColor(Qt::green).darker(130));
+				}
+			}
+		}
+
+		block = block.next();
+		top = bottom;
+		bottom = top + qRound(blockBoundingRect(block).height());
+		++line;
+	}
+}
@@ -0,0 +1,80 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef GRAMMAREDIT_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define GRAMMAREDIT_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtWidgets>
+
+class GrammarEdit;
+
+// Line numbers and markers to the left of the grammar
+class LineGutter : public QWidget {
+	Q_OBJECT
+
+public:
+	explicit LineGutter(GrammarEdit *edit);
+
+	QSize sizeHint() const override;
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+
+private:
+	GrammarEdit *edit;
+};
+
+// The grammar editor widget, which adds a gutter with line numbers and per-line markers for errors, warnings and find hits.
+// Markers are kept in a map ordered by line, so painting looks up just the lines on screen however many markers there are.
+class GrammarEdit : public QPlainTextEdit {
+	Q_OBJECT
+
+public:
+	enum Mark {
+		MARK_ERROR = (1 << 0),
+		MARK_WARNING = (1 << 1),
+		MARK_HIT = (1 << 2),
+	};
+
+	explicit GrammarEdit(QWidget *parent = nullptr);
+
+	void setMarks(Mark kind, const QVector<int>& lines);
+	void clearMarks(Mark kind);
+	int gutterWidth() const;
+	void paintGutter(QPaintEvent *event);
+
+public slots:
+	void updateGutterWidth();
+
+protected:
+	void resizeEvent(QResizeEvent *event) override;
+	void changeEvent(QEvent *event) override;
+
+private slots:
+	void updateGutter(const QRect& rect, int dy);
+
+private:
+	LineGutter *gutter;
+	QMap<int,int> marks;
+};
+
+#endif // GRAMMAREDIT_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -22,22 +22,56 @@
 #include "GrammarEditor.hpp"
 #include "ui_GrammarEditor.h"
 #include "GotoLine.hpp"
+#include "EditorInstance.hpp"
+#include "QueueClient.hpp"
+#include "Trace.hpp"
 #include "inlines.hpp"
 #include "version.hpp"
 #include <algorithm>
 
+// Grammars at least this big are loaded in the background
+constexpr qint64 LOAD_ASYNC_SIZE = 1 << 20;
+// How long each idle highlighting pass may hold the event loop
+constexpr qint64 HILITE_SLICE_MS = 20;
+// Find highlighting is redone at most once per frame, however many scroll and cursor events arrive
+constexpr int FIND_FRAME_MS = 16;
+// Edits are batched this long before the match index hears of them
+constexpr int FIND_INDEX_MS = 100;
+
 GrammarEditor::GrammarEditor(QWidget *parent) :
 	QMainWindow(parent),
 	ui(new Ui::GrammarEditor),
 	check_timer(new QTimer),
 	hilite_timer(new QTimer),
+	idle_timer(new QTimer),
+	find_timer(new QTimer),
+	find_index(new FindIndex),
+	find_overview(nullptr),
+	find_gen(0),
+	find_gen_done(0),
+	find_lines(0),
+	find_pending_first(-1),
+	find_pending_last(-1),
+	find_pending_count(0),
+	find_index_timer(new QTimer),
+	hilite_next(0),
+	saver(new GrammarSaver),
 	rxTrace(CG_TRACE_RX),
 	rxReading(CG_READING_RX),
 	rxReading2(CG_READING_RX2),
 	previewIn_dirty(true),
 	previewIn_run(false),
 	previewOut_run(false),
-	cur_file_check(false)
+	cur_file_check(false),
+	cur_file_changed(false),
+	load_done(0),
+	load_prev_modified(false),
+	load_busy(false),
+	load_ended(false),
+	load_cancel(false),
+	trace_load(0),
+	trace_check(0),
+	trace_preview(0)
 
 {
 	QTemporaryFile tmpf(QDir(QDir::tempPath()).filePath("cg3ide-XXXXXX-") + QVariant(QRandomGenerator::global()->generate64()).toString());
@@ -55,6 +89,10 @@ GrammarEditor::GrammarEditor(QWidget *parent) :
 
 	ui->setupUi(this);
 	reTitle();
+	{
+		QSignalBlocker block(ui->actTrace);
+		ui->actTrace->setChecked(Trace::enabled());
+	}
 
 	defGrammar = ui->editGrammar->toPlainText();
 
@@ -96,6 +134,12 @@ GrammarEditor::GrammarEditor(QWidget *parent) :
 	on_actWrapIO_toggled(ui->actWrapIO->isChecked());
 
 	ui->tableErrors->setModel(&errorEntries);
+	ui->tableErrors->sortByColumn(0, Qt::AscendingOrder);
+	ui->tableErrors->setWordWrap(false);
+	ui->tableErrors->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+	ui->tableErrors->verticalHeader()->setDefaultSectionSize(ui->tableErrors->fontMetrics().height() + 4);
+	ui->tableErrors->horizontalHeader()->setStretchLastSection(true);
+	sizeErrorColumns();
 
 	stxInput.reset(new StreamHighlighter(ui->editStdin->document()));
 	stxInputPreview.reset(new StreamHighlighter(ui->editStdinPreview->document()));
@@ -117,13 +161,31 @@ GrammarEditor::GrammarEditor(QWidget *parent) :
 
 	connect(check_timer.data(), SIGNAL(timeout()), this, SLOT(checkGrammar()));
 	connect(hilite_timer.data(), SIGNAL(timeout()), this, SLOT(reHilite()));
+	idle_timer->setInterval(0);
+	connect(idle_timer.data(), SIGNAL(timeout()), this, SLOT(hiliteIdle()));
+	find_timer->setSingleShot(true);
+	find_timer->setInterval(FIND_FRAME_MS);
+	connect(find_timer.data(), SIGNAL(timeout()), this, SLOT(findHilite()));
+	connect(find_index.data(), SIGNAL(indexed(int)), this, SLOT(findIndex_indexed(int)));
+	find_index_timer->setSingleShot(true);
+	find_index_timer->setInterval(FIND_INDEX_MS);
+	connect(find_index_timer.data(), SIGNAL(timeout()), this, SLOT(findIndexFlush()));
+	connect(ui->editGrammar->document(), SIGNAL(contentsChange(int,int,int)), this, SLOT(grammar_contentsChange(int,int,int)));
+	find_overview = new MatchOverview(ui->editGrammar->verticalScrollBar());
+	find_overview->hide();
+	connect(saver.data(), SIGNAL(saved(QString,QString)), this, SLOT(saver_saved(QString,QString)));
+	journal.reset(new EditJournal(ui->editGrammar->document()));
+	connect(&FileWatcher::instance(), SIGNAL(filesChanged(QStringList)), this, SLOT(watcher_filesChanged(QStringList)));
 	connect(ui->editGrammar->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(scrollValue_Changed(int)));
+	connect(ui->editGrammar->horizontalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(scrollValue_Changed(int)));
 
 	reOptions();
 	ui->editGrammar->textChanged();
 }
 
 GrammarEditor::~GrammarEditor() {
+	// The document outlives our members, and must not report its teardown to them
+	ui->editGrammar->document()->disconnect(this);
 }
 
 void GrammarEditor::closeEvent(QCloseEvent *event) {
@@ -141,6 +203,19 @@ void GrammarEditor::closeEvent(QCloseEvent *event) {
 		}
 	}
 
+	// A save still being written must be on disk before the window goes, and a failed one keeps it open
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	auto error = saver->waitForIdle();
+	QApplication::restoreOverrideCursor();
+	if (!error.isEmpty()) {
+		event->ignore();
+		return;
+	}
+	journal->discard();
+	FileWatcher::instance().setPaths(this, "grammar", QStringList());
+	FileWatcher::instance().setPaths(this, "includes", QStringList());
+	FileWatcher::instance().setPaths(this, "inputs", QStringList());
+
 	QFile(checker.txtGrammar).remove();
 	QFile(checker.binGrammar).remove();
 	QFile(checker.inputFile).remove();
@@ -162,11 +237,7 @@ void GrammarEditor::on_actHelp_triggered() {
 }
 
 void GrammarEditor::on_actNew_triggered() {
-	if (launchEditor()) {
-		return;
-	}
-	GrammarEditor *n = new GrammarEditor;
-	n->show();
+	EditorInstance::openWindow();
 }
 
 void GrammarEditor::on_actClose_triggered() {
@@ -184,6 +255,8 @@ void GrammarEditor::on_actClose_triggered() {
 
 	ui->editGrammar->setPlainText(defGrammar);
 	cur_file = QFileInfo();
+	journal->setFileName(QString());
+	watchFile(QString());
 	reTitle();
 }
 
@@ -195,7 +268,29 @@ void GrammarEditor::reTitle() {
 }
 
 void GrammarEditor::reHilite() {
+	TRACE_SPAN("rehighlight");
 	stxGrammar->clear();
+	reSections();
+}
+
+// Highlights a grammar that was loaded in the background, a slice of blocks at a time, so the window stays usable meanwhile
+void GrammarEditor::hiliteIdle() {
+	TRACE_SPAN("highlight slice");
+	QElapsedTimer clock;
+	clock.start();
+	auto block = ui->editGrammar->document()->findBlockByNumber(hilite_next);
+	for ( ; block.isValid() && clock.elapsed() < HILITE_SLICE_MS ; block = block.next()) {
+		stxGrammar->rehighlightBlock(block);
+	}
+	if (block.isValid()) {
+		hilite_next = block.blockNumber();
+		return;
+	}
+	idle_timer->stop();
+	reSections();
+}
+
+void GrammarEditor::reSections() {
 	while (section_jump->count() > 1) {
 		section_jump->removeItem(section_jump->count()-1);
 	}
@@ -290,6 +385,7 @@ void GrammarEditor::refreshInput() {
 	if (!previewIn_dirty) {
 		return;
 	}
+	TRACE_SPAN("refresh input");
 	QSettings settings;
 
 	auto input = ui->editStdin->toPlainText();
@@ -386,8 +482,20 @@ void GrammarEditor::checkGrammar() {
 	QFile(checker.binGrammar).remove();
 	QFile(checker.inputFile).remove();
 
+	// Watch what the grammar includes, so editing those elsewhere also triggers a re-check
+	static QRegularExpression rx_include(R"X(^\s*INCLUDE\s+(?:STATIC\s+)?(\S+?)\s*;)X", QRegularExpression::MultilineOption | QRegularExpression::CaseInsensitiveOption);
+	QStringList includes;
+	auto dir = cur_file.filePath().isEmpty() ? QDir::current() : cur_file.dir();
+	auto it = rx_include.globalMatch(ui->editGrammar->toPlainText());
+	while (it.hasNext()) {
+		auto m = it.next();
+		includes << dir.absoluteFilePath(m.captured(1));
+	}
+	FileWatcher::instance().setPaths(this, "includes", includes);
+
 	if (filePutContents(checker.txtGrammar, ui->editGrammar->toPlainText())) {
-		checker.process.reset(new QProcess);
+		checker.process.reset(new LimitedProcess);
+		checker.process->setLimits(limitsFromSettings());
 		connect(checker.process.data(), SIGNAL(finished(int)), this, SLOT(checkGrammar_finished(int)));
 		checker.process->setWorkingDirectory(cur_file.dir().path());
 		checker.process->setProcessChannelMode(QProcess::MergedChannels);
@@ -395,19 +503,48 @@ void GrammarEditor::checkGrammar() {
 							   QStringList() << "--grammar-only" << "-v"
 							   << "-g" << checker.txtGrammar
 							   << "--grammar-bin" << checker.binGrammar, QIODevice::ReadOnly);
+		trace_check = Trace::now();
+	}
+}
+
+// Diagnostics are kept by the block they start in. Any edit that adds or removes blocks clears them, so the keys stay true.
+void GrammarEditor::addErrorSelection(const QTextEdit::ExtraSelection& selection) {
+	auto block = ui->editGrammar->document()->findBlock(selection.cursor.selectionStart());
+	errorSelections[block.blockNumber()].append(selection);
+}
+
+// Column widths from what the widest cell must be, rather than measuring every row with resizeColumnsToContents()
+void GrammarEditor::sizeErrorColumns() {
+	auto fm = ui->tableErrors->fontMetrics();
+	auto hdr = ui->tableErrors->horizontalHeader();
+	auto pad = 2 * ui->tableErrors->style()->pixelMetric(QStyle::PM_FocusFrameHMargin) + 8;
+	auto line = QString::number(std::max(errorEntries.maxLine(), ui->editGrammar->blockCount()));
+	auto w = std::max(fm.horizontalAdvance(line), fm.horizontalAdvance(tr("Line")));
+	if (hdr->sectionSize(0) < w + pad) {
+		hdr->resizeSection(0, w + pad);
+	}
+	w = std::max(fm.horizontalAdvance(tr("Warning")), fm.horizontalAdvance(tr("Error"))) + ui->tableErrors->style()->pixelMetric(QStyle::PM_SmallIconSize) + 4;
+	if (hdr->sectionSize(1) < w + pad) {
+		hdr->resizeSection(1, w + pad);
 	}
 }
 
 void GrammarEditor::checkGrammar_finished(int) {
+	if (Trace::enabled()) {
+		Trace::record("compile grammar", trace_check);
+	}
+	TRACE_SPAN("error table");
 	QSettings settings;
 	QTextStream log(checker.process.data());
 	setEncoding(log);
-	ui->editStderr->setPlainText(log.readAll());
-	auto vz = ui->tableErrors->verticalScrollBar()->value(), hz = ui->tableErrors->horizontalScrollBar()->value();
+	auto text = log.readAll();
+	if (!checker.process->breach().isEmpty()) {
+		text = tr("CG-3 was %1 while compiling the grammar\n").arg(checker.process->breach()) + text;
+	}
+	ui->editStderr->setPlainText(text);
 
 	errorSelections.clear();
-	errorEntries.clear();
-	errorEntries.setHorizontalHeaderLabels(QStringList() << "Line" << "Type" << "Message");
+	QVector<Diagnostic> diagnostics;
 	auto warnColor = QColor(Qt::blue).lighter(190);
 	auto errColor = QColor(Qt::red).lighter(190);
 	auto cur = ui->editGrammar->textCursor();
@@ -421,6 +558,7 @@ void GrammarEditor::checkGrammar_finished(int) {
 	rxs.append(QRegularExpression("on line (\\d+)"));
 	rxs.append(QRegularExpression("before line (\\d+)"));
 
+	QVector<int> mark_errors, mark_warnings;
 	auto lines = ui->editStderr->toPlainText().split("\n");
 	for (auto& line : lines) {
 		for (auto& rx : rxs) {
@@ -430,30 +568,24 @@ void GrammarEditor::checkGrammar_finished(int) {
 				caps.pop_front();
 				for (auto& cap : caps) {
 					QTextEdit::ExtraSelection selection;
-					QList<QStandardItem*> row;
-					row << new QStandardItem << new QStandardItem << new QStandardItem(line.section(':', 1).simplified());
-					row[0]->setData(cap.toInt(), Qt::DisplayRole);
+					Diagnostic d{cap.toInt(), Diagnostic::KIND_ERROR, line.section(':', 1).simplified()};
 					if (line.contains("Warning:")) {
+						mark_warnings.append(cap.toInt()-1);
 						selection.format.setBackground(warnColor);
-						row[1]->setData(tr("Warning"), Qt::DisplayRole);
-						row[1]->setIcon(style()->standardIcon(QStyle::SP_MessageBoxWarning));
+						d.kind = Diagnostic::KIND_WARNING;
 					}
 					else {
+						mark_errors.append(cap.toInt()-1);
 						selection.format.setBackground(errColor);
-						row[1]->setData(tr("Error"), Qt::DisplayRole);
-						row[1]->setIcon(style()->standardIcon(QStyle::SP_MessageBoxCritical));
 					}
-					row[0]->setEditable(false);
-					row[1]->setEditable(false);
-					row[2]->setEditable(false);
-					errorEntries.appendRow(row);
+					diagnostics.append(d);
 					selection.format.setProperty(QTextFormat::FullWidthSelection, true);
 					selection.format.setToolTip(line);
 					selection.cursor = cur;
 					curGotoLine(selection.cursor, cap.toInt()-1);
 					selection.cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
 					selection.cursor.movePosition(QTextCursor::NextCharacter, QTextCursor::KeepAnchor);
-					errorSelections.append(selection);
+					addErrorSelection(selection);
 				}
 			}
 		}
@@ -471,38 +603,24 @@ void GrammarEditor::checkGrammar_finished(int) {
 				goto reparsed;
 			}
 			QTextEdit::ExtraSelection selection;
-			QList<QStandardItem*> row;
-			row << new QStandardItem << new QStandardItem << new QStandardItem(s->error);
-			row[0]->setData(block.blockNumber()+1, Qt::DisplayRole);
+			diagnostics.append(Diagnostic{block.blockNumber()+1, Diagnostic::KIND_ERROR, s->error});
+			mark_errors.append(block.blockNumber());
 			selection.format.setBackground(errColor);
-			row[1]->setData(tr("Error"), Qt::DisplayRole);
-			row[1]->setIcon(style()->standardIcon(QStyle::SP_MessageBoxCritical));
-			row[0]->setEditable(false);
-			row[1]->setEditable(false);
-			row[2]->setEditable(false);
-			errorEntries.appendRow(row);
 			selection.format.setProperty(QTextFormat::FullWidthSelection, true);
 			selection.format.setToolTip(s->error);
 			selection.cursor = cur;
 			curGotoLine(selection.cursor, block.blockNumber());
 			selection.cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
 			selection.cursor.movePosition(QTextCursor::NextCharacter, QTextCursor::KeepAnchor);
-			errorSelections.append(selection);
+			addErrorSelection(selection);
 		}
 	}
 	for (auto block = ui->editGrammar->document()->begin() ; block.isValid() ; block = block.next()) {
 		auto s = static_cast<GrammarState*>(block.userData());
 		for (auto it = s->warnings.begin() ; it != s->warnings.end() ; ++it) {
 			QTextEdit::ExtraSelection selection;
-			QList<QStandardItem*> row;
-			row << new QStandardItem << new QStandardItem << new QStandardItem(it.value());
-			row[0]->setData(block.blockNumber()+1, Qt::DisplayRole);
-			row[1]->setData(tr("Warning"), Qt::DisplayRole);
-			row[1]->setIcon(style()->standardIcon(QStyle::SP_MessageBoxWarning));
-			row[0]->setEditable(false);
-			row[1]->setEditable(false);
-			row[2]->setEditable(false);
-			errorEntries.appendRow(row);
+			diagnostics.append(Diagnostic{block.blockNumber()+1, Diagnostic::KIND_WARNING, it.value()});
+			mark_warnings.append(block.blockNumber());
 			selection.format.setFontUnderline(true);
 			selection.format.setUnderlineColor(Qt::darkRed);
 			selection.format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
@@ -511,16 +629,16 @@ void GrammarEditor::checkGrammar_finished(int) {
 			curGotoLine(selection.cursor, block.blockNumber());
 			selection.cursor.setPosition(selection.cursor.position()+it.key().first, QTextCursor::MoveAnchor);
 			selection.cursor.setPosition(selection.cursor.position()+it.key().second, QTextCursor::KeepAnchor);
-			errorSelections.append(selection);
+			addErrorSelection(selection);
 		}
 	}
 
-	errorEntries.sort(0);
-	ui->tableErrors->horizontalHeader()->setStretchLastSection(true);
-	ui->tableErrors->resizeColumnsToContents();
-	ui->tableErrors->repaint();
-	ui->tableErrors->verticalScrollBar()->setValue(vz);
-	ui->tableErrors->horizontalScrollBar()->setValue(hz);
+	ui->editGrammar->setMarks(GrammarEdit::MARK_ERROR, mark_errors);
+	ui->editGrammar->setMarks(GrammarEdit::MARK_WARNING, mark_warnings);
+
+	// Rows that survive the recheck stay put, so the table keeps its scroll position and selection by itself
+	errorEntries.setDiagnostics(diagnostics);
+	sizeErrorColumns();
 	on_editGrammar_cursorPositionChanged();
 
 	if (settings.value("cg3/previewoutput", true).toBool() || previewOut_run) {
@@ -547,23 +665,33 @@ void GrammarEditor::previewRun() {
 		previewIn_run = false;
 	}
 	if (filePutContents(checker.txtGrammar, ui->editGrammar->toPlainText()) && filePutContents(checker.inputFile, ui->editStdinPreview->toPlainText())) {
-		checker.process->disconnect();
+		// Only our own connections, as the process watches itself for going over its limits
+		checker.process->disconnect(this);
 		connect(checker.process.data(), SIGNAL(finished(int)), this, SLOT(previewOutRun_finished(int)));
 		checker.process->setProcessChannelMode(QProcess::SeparateChannels);
 		checker.process->start(settings.value("cg3/binary").toString(),
 							   QStringList() << "-v" << "--trace"
 							   << "-g" << checker.binGrammar
 							   << "-I" << checker.inputFile, QIODevice::ReadOnly);
+		trace_preview = Trace::now();
 	}
 }
 
 void GrammarEditor::previewOutRun_finished(int) {
+	if (Trace::enabled()) {
+		Trace::record("preview run", trace_preview);
+	}
 	stdout_raw = checker.process->readAllStandardOutput();
-	ui->editStderrPreviewOutput->setPlainText(checker.process->readAllStandardError());
+	QString err = checker.process->readAllStandardError();
+	if (!checker.process->breach().isEmpty()) {
+		err = tr("CG-3 was %1 while running the preview\n").arg(checker.process->breach()) + err;
+	}
+	ui->editStderrPreviewOutput->setPlainText(err);
 	previewOutRun_render();
 }
 
 void GrammarEditor::previewOutRun_render() {
+	TRACE_SPAN("render output");
 	QString out = stdout_raw;
 	QStringList olines;
 
@@ -615,38 +743,126 @@ void GrammarEditor::previewOutRun_render() {
 	ui->editStdout->horizontalScrollBar()->setValue(hz);
 }
 
-bool GrammarEditor::eventFilter(QObject *watched, QEvent *event) {
-	if (event->type() == QEvent::WindowActivate && !cur_file_check && !ui->editGrammar->document()->isModified()) {
-		QFileInfo check(cur_file.filePath());
-		if (check.exists()) {
-			if (cur_file == check && (cur_file.birthTime() != check.birthTime() || cur_file.lastModified() != check.lastModified() || cur_file.size() != check.size())) {
-				cur_file_check = true;
-				int yesno = QMessageBox::question(this, tr("Reload changed file?"), tr("The file %1 has changed on disk since last save. Do you want to reload it? Any changes made here will be lost.").arg(check.filePath()), QMessageBox::Yes, QMessageBox::No);
-				if (yesno == QMessageBox::Yes) {
-					auto vz = ui->editGrammar->verticalScrollBar()->value(), hz = ui->editGrammar->horizontalScrollBar()->value();
-					auto pos = ui->editGrammar->textCursor().position();
-					open(check.filePath());
-					QTextCursor tc = ui->editGrammar->textCursor();
-					tc.setPosition(pos);
-					ui->editGrammar->setTextCursor(tc);
-					ui->editGrammar->verticalScrollBar()->setValue(vz);
-					ui->editGrammar->horizontalScrollBar()->setValue(hz);
-				}
-				else {
-					ui->editGrammar->document()->setModified(true);
-				}
-				cur_file_check = false;
+// Asks to reload the grammar after the watcher saw it change, unless the change was our own save
+void GrammarEditor::checkFileChanged() {
+	if (cur_file_check || saver->isBusy()) {
+		return;
+	}
+	cur_file_changed = false;
+	if (ui->editGrammar->document()->isModified()) {
+		return;
+	}
+	QFileInfo check(cur_file.filePath());
+	if (check.exists()) {
+		if (cur_file == check && (cur_file.birthTime() != check.birthTime() || cur_file.lastModified() != check.lastModified() || cur_file.size() != check.size())) {
+			cur_file_check = true;
+			int yesno = QMessageBox::question(this, tr("Reload changed file?"), tr("The file %1 has changed on disk since last save. Do you want to reload it? Any changes made here will be lost.").arg(check.filePath()), QMessageBox::Yes, QMessageBox::No);
+			if (yesno == QMessageBox::Yes) {
+				auto vz = ui->editGrammar->verticalScrollBar()->value(), hz = ui->editGrammar->horizontalScrollBar()->value();
+				auto pos = ui->editGrammar->textCursor().position();
+				open(check.filePath());
+				QTextCursor tc = ui->editGrammar->textCursor();
+				tc.setPosition(pos);
+				ui->editGrammar->setTextCursor(tc);
+				ui->editGrammar->verticalScrollBar()->setValue(vz);
+				ui->editGrammar->horizontalScrollBar()->setValue(hz);
+			}
+			else {
+				ui->editGrammar->document()->setModified(true);
 			}
+			cur_file_check = false;
 		}
 	}
+}
+
+void GrammarEditor::watcher_filesChanged(const QStringList& paths) {
+	auto& fw = FileWatcher::instance();
+	auto grammar = cur_file.absoluteFilePath();
+	bool inputs = false, includes = false;
+	for (auto& path : paths) {
+		if (path == grammar) {
+			// Only asked right away when we're in front, otherwise when the window is next activated
+			cur_file_changed = true;
+			if (isActiveWindow()) {
+				checkFileChanged();
+			}
+		}
+		else if (path == grammar + ".cg3p") {
+			loadState(grammar);
+		}
+		else if (fw.paths(this, "inputs").contains(path)) {
+			inputs = true;
+		}
+		else if (fw.paths(this, "includes").contains(path)) {
+			includes = true;
+		}
+	}
+
+	if (inputs) {
+		previewIn_dirty = true;
+		previewIn_run = true;
+	}
+	QSettings settings;
+	if ((inputs || includes) && settings.value("cg3/previewoutput", true).toBool()) {
+		check_timer->stop();
+		check_timer->setSingleShot(true);
+		check_timer->start(settings.value("cg3/livedelay", 2000).toInt());
+	}
+}
+
+void GrammarEditor::watchFile(const QString& filename) {
+	QStringList paths;
+	if (!filename.isEmpty()) {
+		paths << filename << filename + ".cg3p";
+	}
+	FileWatcher::instance().setPaths(this, "grammar", paths);
+}
+
+// Fills the input panes from the .cg3p next to the grammar. When it changes under us, panes edited since are left alone.
+void GrammarEditor::loadState(const QString& filename) {
+	QFileInfo cg3p(filename + ".cg3p");
+	if (!cg3p.exists() || !cg3p.isReadable()) {
+		return;
+	}
+	QSettings state(cg3p.filePath(), QSettings::Format::IniFormat);
+	QList<QPair<QString,QPlainTextEdit*>> panes;
+	panes << qMakePair(QString("input_text"), ui->editStdin) << qMakePair(QString("input_files"), ui->editInputFiles) << qMakePair(QString("input_pipe"), ui->editInputPipe);
+	for (auto& pane : panes) {
+		if (!state.contains(pane.first)) {
+			continue;
+		}
+		auto value = state.value(pane.first).toString();
+		if (cur_state.contains(pane.first) && pane.second->toPlainText() != cur_state.value(pane.first).toString()) {
+			continue;
+		}
+		if (pane.second->toPlainText() != value) {
+			pane.second->setPlainText(value);
+		}
+		cur_state[pane.first] = value;
+	}
+	on_editInputPipe_textChanged();
+}
+
+bool GrammarEditor::eventFilter(QObject *watched, QEvent *event) {
+	// A resize changes what's visible without any scrolling, and isn't handled further
+	if (watched == ui->editGrammar->viewport() && event->type() == QEvent::Resize) {
+		on_editFind_textEdited();
+	}
+
+	if (event->type() == QEvent::WindowActivate && cur_file_changed) {
+		checkFileChanged();
+	}
 	else if (watched == ui->editGrammar) {
 		if (event->type() == QEvent::ToolTip) {
 			auto helpEvent = static_cast<QHelpEvent*>(event);
 			auto cur = ui->editGrammar->cursorForPosition(helpEvent->pos());
 			QStringList tips;
-			for (auto& es : errorSelections) {
-				if (cur.position() >= es.cursor.selectionStart() && cur.position() <= es.cursor.selectionEnd()) {
-					tips << es.format.toolTip();
+			int block = cur.blockNumber();
+			for (auto it = errorSelections.lowerBound(block-1) ; it != errorSelections.end() && it.key() <= block ; ++it) {
+				for (auto& es : it.value()) {
+					if (cur.position() >= es.cursor.selectionStart() && cur.position() <= es.cursor.selectionEnd()) {
+						tips << es.format.toolTip();
+					}
 				}
 			}
 
@@ -726,7 +942,7 @@ bool GrammarEditor::eventFilter(QObject *watched, QEvent *event) {
 							first = false;
 						}
 						else {
-							launchEditor(url.toLocalFile());
+							EditorInstance::openWindow(url.toLocalFile());
 						}
 					}
 				}
@@ -769,6 +985,8 @@ bool GrammarEditor::eventFilter(QObject *watched, QEvent *event) {
 }
 
 bool GrammarEditor::save(const QString& filename) {
+	TraceSpan span("save");
+	span.setDetail(filename);
 	QFileInfo check(filename);
 	if (check.exists()) {
 		if (check.isWritable() == false) {
@@ -776,7 +994,8 @@ bool GrammarEditor::save(const QString& filename) {
 			return false;
 		}
 
-		if (cur_file == check && (cur_file.birthTime() != check.birthTime() || cur_file.lastModified() != check.lastModified() || cur_file.size() != check.size())) {
+		// While an earlier save is still landing, the change on disk is our own
+		if (cur_file == check && !saver->isBusy() && (cur_file.birthTime() != check.birthTime() || cur_file.lastModified() != check.lastModified() || cur_file.size() != check.size())) {
 			int yesno = QMessageBox::question(this, tr("Overwrite changed file?"), tr("The file %1 has changed on disk since last save. Do you want to overwrite it with the current grammar?").arg(filename), QMessageBox::Yes, QMessageBox::No);
 			if (yesno != QMessageBox::Yes) {
 				return false;
@@ -784,32 +1003,61 @@ bool GrammarEditor::save(const QString& filename) {
 		}
 	}
 
-	if (!filePutContents(filename, ui->editGrammar->toPlainText())) {
-		return false;
-	}
+	// Written in the background; the document counts as saved from here, and goes back to modified if the write fails
+	QVariantMap state;
+	state["input_text"] = ui->editStdin->toPlainText();
+	state["input_files"] = ui->editInputFiles->toPlainText();
+	state["input_pipe"] = ui->editInputPipe->toPlainText();
+	saver->save(filename, ui->editGrammar->toPlainText(), state);
 
 	ui->editGrammar->document()->setModified(false);
-
 	cur_file.setFile(filename);
+	cur_state = state;
+	journal->setFileName(filename);
+	watchFile(filename);
+	reTitle();
+
+	return true;
+}
+
+void GrammarEditor::saver_saved(const QString& filename, const QString& error) {
+	if (cur_file.filePath() != filename) {
+		if (!error.isEmpty()) {
+			QMessageBox::critical(this, tr("Save failed!"), error);
+		}
+		return;
+	}
+	if (!error.isEmpty()) {
+		ui->editGrammar->document()->setModified(true);
+		QMessageBox::critical(this, tr("Save failed!"), error);
+		return;
+	}
 	cur_file.refresh();
 	cur_file.birthTime();
 	cur_file.lastModified();
 	cur_file.size();
+}
 
-	QFileInfo cg3p(filename + ".cg3p");
-	if (!cg3p.exists() || cg3p.isWritable()) {
-		QSettings state(cg3p.filePath(), QSettings::Format::IniFormat);
-		state.setValue("input_text", ui->editStdin->toPlainText());
-		state.setValue("input_files", ui->editInputFiles->toPlainText());
-		state.setValue("input_pipe", ui->editInputPipe->toPlainText());
+// Takes over text replayed from a crashed session's journal. It stays modified, and journaled anew, until saved.
+void GrammarEditor::recover(const QString& filename, const QString& text) {
+	QFileInfo check(filename);
+	if (!filename.isEmpty() && check.exists()) {
+		ui->editGrammar->setPlainText(text);
+		opened(filename);
 	}
-
+	else {
+		ui->editGrammar->setPlainText(text);
+		journal->setFileName(filename);
+		cur_file.setFile(filename);
+	}
+	ui->editGrammar->document()->setModified(true);
+	journal->checkpoint();
 	reTitle();
-
-	return true;
 }
 
 void GrammarEditor::open(const QString& filename) {
+	TraceSpan span("open");
+	span.setDetail(filename);
 	QFileInfo check(filename);
 	if (check.exists() == false) {
 		QMessageBox::information(this, tr("No such file!"), tr("The file %1 does not exist!").arg(filename));
@@ -820,13 +1068,137 @@ void GrammarEditor::open(const QString& filename) {
 		return;
 	}
 
+	if (check.size() >= LOAD_ASYNC_SIZE) {
+		loadAsync(check.filePath());
+		return;
+	}
+
 	QString text = fileGetContents(filename);
 	if (text.isNull()) {
 		return;
 	}
 
 	ui->editGrammar->setPlainText(text);
+	opened(filename);
+}
+
+// Decoding happens on a worker thread, and the text is appended a slice at a time with highlighting deferred to idle time.
+// The editor is read-only and its signals are held back until the whole file is in.
+void GrammarEditor::loadAsync(const QString& filename) {
+	trace_load = Trace::now();
+	idle_timer->stop();
+	load_prev = ui->editGrammar->toPlainText();
+	load_prev_modified = ui->editGrammar->document()->isModified();
+	load_pending.clear();
+	load_error.clear();
+	load_done = 0;
+	load_ended = false;
+	load_cancel = false;
+
+	errorSelections.clear();
+	errorEntries.clear();
+	ui->editGrammar->clearMarks(GrammarEdit::MARK_ERROR);
+	ui->editGrammar->clearMarks(GrammarEdit::MARK_WARNING);
+	stxGrammar->set_lines.clear();
+	stxGrammar->tmpl_lines.clear();
+	stxGrammar->section_lines.clear();
+	stxGrammar->setDeferred(true);
+	journal->setPaused(true);
+	ui->editGrammar->blockSignals(true);
+	ui->editGrammar->setReadOnly(true);
+	ui->editGrammar->document()->setUndoRedoEnabled(false);
+	ui->editGrammar->clear();
+
+	load_progress.reset(new QProgressDialog(tr("Loading %1...").arg(QFileInfo(filename).fileName()), tr("Cancel"), 0, 1000, this));
+	load_progress->setWindowModality(Qt::WindowModal);
+	load_progress->setMinimumDuration(500);
+	load_progress->setValue(0);
+	connect(load_progress.data(), SIGNAL(canceled()), this, SLOT(load_canceled()));
+
+	loader.reset(new GrammarLoader(filename));
+	connect(loader.data(), SIGNAL(decoded(QString,qint64)), this, SLOT(loader_decoded(QString,qint64)));
+	connect(loader.data(), SIGNAL(failed(QString)), this, SLOT(loader_failed(QString)));
+	connect(loader.data(), SIGNAL(finished()), this, SLOT(loader_finished()));
+	loader->start();
+}
+
+void GrammarEditor::loader_decoded(const QString& text, qint64 done) {
+	load_pending.append(text);
+	load_done = done;
+	// Updating a modal progress dialog runs the event loop, so more text can arrive while a slice is being inserted
+	if (load_busy) {
+		return;
+	}
+	load_busy = true;
+	while (!load_pending.isEmpty() && !load_cancel) {
+		QTextCursor cur(ui->editGrammar->document());
+		cur.movePosition(QTextCursor::End);
+		cur.insertText(load_pending.takeFirst());
+		load_progress->setValue(static_cast<int>(load_done * 1000 / std::max(loader->size(), qint64(1))));
+	}
+	load_busy = false;
+	if (load_ended) {
+		loader_finished();
+	}
+}
+
+void GrammarEditor::loader_failed(const QString& error) {
+	load_error = error;
+}
+
+void GrammarEditor::load_canceled() {
+	load_cancel = true;
+	loader->requestInterruption();
+}
+
+void GrammarEditor::loader_finished() {
+	if (load_busy) {
+		load_ended = true;
+		return;
+	}
+	load_ended = false;
+
+	auto filename = loader->fileName();
+	if (Trace::enabled()) {
+		Trace::record("load grammar", trace_load, filename);
+	}
+	loader.take()->deleteLater();
+	load_progress.take()->deleteLater();
+	load_pending.clear();
+
+	stxGrammar->setDeferred(false);
+	journal->setPaused(false);
+	ui->editGrammar->document()->setUndoRedoEnabled(true);
+	ui->editGrammar->setReadOnly(false);
+	ui->editGrammar->blockSignals(false);
+	// blockCountChanged() was blocked along with everything else while loading
+	ui->editGrammar->updateGutterWidth();
+
+	if (load_cancel || !load_error.isEmpty()) {
+		if (!load_error.isEmpty()) {
+			QMessageBox::information(this, tr("Open failed!"), load_error);
+		}
+		ui->editGrammar->setPlainText(load_prev);
+		ui->editGrammar->document()->setModified(load_prev_modified);
+		if (!load_prev_modified) {
+			journal->markClean();
+		}
+		load_prev.clear();
+		return;
+	}
+	load_prev.clear();
+
+	opened(filename);
+	ui->editGrammar->textChanged();
+	on_editGrammar_cursorPositionChanged();
+	hilite_next = 0;
+	idle_timer->start();
+}
+
+void GrammarEditor::opened(const QString& filename) {
 	ui->editGrammar->document()->setModified(false);
+	journal->setFileName(filename);
+	journal->markClean();
 
 	cur_file.setFile(filename);
 	cur_file.refresh();
@@ -834,20 +1206,10 @@ void GrammarEditor::open(const QString& filename) {
 	cur_file.lastModified();
 	cur_file.size();
 
-	QFileInfo cg3p(filename + ".cg3p");
-	if (cg3p.exists() && cg3p.isReadable()) {
-		QSettings state(cg3p.filePath(), QSettings::Format::IniFormat);
-		if (state.contains("input_text")) {
-			ui->editStdin->setPlainText(state.value("input_text").toString());
-		}
-		if (state.contains("input_files")) {
-			ui->editInputFiles->setPlainText(state.value("input_files").toString());
-		}
-		if (state.contains("input_pipe")) {
-			ui->editInputPipe->setPlainText(state.value("input_pipe").toString());
-		}
-		on_editInputPipe_textChanged();
-	}
+	cur_file_changed = false;
+	cur_state.clear();
+	loadState(filename);
+	watchFile(filename);
 
 	reTitle();
 }
@@ -908,6 +1270,7 @@ void GrammarEditor::on_actOptions_triggered() {
 void GrammarEditor::on_actFindHide_triggered() {
 	ui->frameFindReplace->hide();
 	ui->editGrammar->setFocus();
+	findIndexReset();
 	on_editGrammar_cursorPositionChanged();
 }
 
@@ -929,18 +1292,15 @@ void GrammarEditor::on_actFindNext_triggered() {
 	if (!ui->frameFindReplace->isVisible()) {
 		return on_actFindReplace_triggered();
 	}
-
-	auto p = ui->editFind->text();
-	if (!ui->optFindRegex->isChecked()) {
-		p = QRegularExpression::escape(p);
+	if (findJump(false)) {
+		return;
 	}
+
 	QTextDocument::FindFlags ff = QTextDocument::FindCaseSensitively;
-	QRegularExpression::PatternOptions opts = QRegularExpression::InvertedGreedinessOption;
 	if (!ui->optFindCase->isChecked()) {
 		ff &= ~QTextDocument::FindCaseSensitively;
-		opts |= QRegularExpression::CaseInsensitiveOption;
 	}
-	QRegularExpression find(p, opts);
+	const auto& find = findRegex();
 	if (!find.isValid()) {
 		return;
 	}
@@ -963,18 +1323,15 @@ void GrammarEditor::on_actFindPrev_triggered() {
 	if (!ui->frameFindReplace->isVisible()) {
 		return on_actFindReplace_triggered();
 	}
-
-	auto p = ui->editFind->text();
-	if (!ui->optFindRegex->isChecked()) {
-		p = QRegularExpression::escape(p);
+	if (findJump(true)) {
+		return;
 	}
+
 	QTextDocument::FindFlags ff = QTextDocument::FindBackward | QTextDocument::FindCaseSensitively;
-	QRegularExpression::PatternOptions opts = QRegularExpression::InvertedGreedinessOption;
 	if (!ui->optFindCase->isChecked()) {
 		ff &= ~QTextDocument::FindCaseSensitively;
-		opts |= QRegularExpression::CaseInsensitiveOption;
 	}
-	QRegularExpression find(p, opts);
+	const auto& find = findRegex();
 	if (!find.isValid()) {
 		return;
 	}
@@ -998,17 +1355,11 @@ void GrammarEditor::on_actReplaceOnce_triggered() {
 		return on_actFindReplace_triggered();
 	}
 
-	auto p = ui->editFind->text();
-	if (!ui->optFindRegex->isChecked()) {
-		p = QRegularExpression::escape(p);
-	}
 	QTextDocument::FindFlags ff = QTextDocument::FindCaseSensitively;
-	QRegularExpression::PatternOptions opts = QRegularExpression::InvertedGreedinessOption;
 	if (!ui->optFindCase->isChecked()) {
 		ff &= ~QTextDocument::FindCaseSensitively;
-		opts |= QRegularExpression::CaseInsensitiveOption;
 	}
-	QRegularExpression find(p, opts);
+	const auto& find = findRegex();
 	if (!find.isValid()) {
 		return;
 	}
@@ -1035,70 +1386,136 @@ void GrammarEditor::on_actReplaceOnce_triggered() {
 	on_editFind_textEdited();
 }
 
+// Finds every match in one pass over a snapshot and swaps in the rewritten span as a single edit,
+// rather than letting the document re-layout and the search restart for each match
 void GrammarEditor::on_actReplaceAll_triggered() {
 	if (!ui->frameFindReplace->isVisible()) {
 		return on_actFindReplace_triggered();
 	}
 
-	auto p = ui->editFind->text();
-	if (!ui->optFindRegex->isChecked()) {
-		p = QRegularExpression::escape(p);
-	}
-	QTextDocument::FindFlags ff = QTextDocument::FindCaseSensitively;
-	QRegularExpression::PatternOptions opts = QRegularExpression::InvertedGreedinessOption;
-	if (!ui->optFindCase->isChecked()) {
-		ff &= ~QTextDocument::FindCaseSensitively;
-		opts |= QRegularExpression::CaseInsensitiveOption;
-	}
-	QRegularExpression find(p, opts);
-	if (!find.isValid()) {
+	const auto& find = findRegex();
+	if (ui->editFind->text().isEmpty() || !find.isValid()) {
 		return;
 	}
+	TRACE_SPAN("replace all");
+	QElapsedTimer clock;
+	clock.start();
 
+	auto replacement = ui->editReplace->text();
+	// Raw text, as toPlainText() would turn non-breaking spaces between the matches into plain ones
+	auto text = ui->editGrammar->document()->toRawText();
 	auto cur = ui->editGrammar->textCursor();
-	cur.beginEditBlock();
-	auto res = ui->editGrammar->document()->find(find, cur.selectionStart(), ff);
+	int from = cur.selectionStart(), count = 0;
+
+	// One edit per line that has matches, from its first match to its last, so the other lines keep their
+	// formatting and highlighter state, and the journal and find index only see the lines that changed
+	struct LineEdit {
+		int start, end;
+		QString text;
+	};
+	QVector<LineEdit> edits;
+
+	// Line by line, as document()->find() never matched across lines either.
+	// The cursor's line is searched whole, so ^ only matches at its start, but matches before the cursor are skipped.
+	for (int bol = ui->editGrammar->document()->findBlock(from).position() ; bol <= text.size() ; ) {
+		auto eol = text.indexOf(QChar::ParagraphSeparator, bol);
+		if (eol < 0) {
+			eol = text.size();
+		}
+		auto line = text.mid(bol, eol - bol);
+		auto matches = find.globalMatch(line);
+		LineEdit edit{-1, -1, QString()};
+		while (matches.hasNext()) {
+			auto match = matches.next();
+			int ms = bol + match.capturedStart(0), me = bol + match.capturedEnd(0);
+			if (ms < from) {
+				continue;
+			}
+			if (edit.start < 0) {
+				edit.start = ms;
+			}
+			else {
+				edit.text.append(text.constData() + edit.end, ms - edit.end);
+			}
+			auto rep = match.captured(0);
+			rep.replace(find, replacement);
+			edit.text.append(rep);
+			edit.end = me;
+			++count;
+		}
+		if (edit.start >= 0) {
+			edits.append(edit);
+		}
+		bol = eol + 1;
+	}
 
-	while (!res.isNull()) {
-		auto text = res.selectedText();
-		text.replace(find, ui->editReplace->text());
-		res.removeSelectedText();
-		cur.setPosition(res.selectionStart());
-		cur.insertText(text);
-		res = ui->editGrammar->document()->find(find, cur.selectionStart()+text.length(), ff);
+	// Back to front, so the positions of the edits still to come don't move, and as one step to undo
+	if (count) {
+		cur.beginEditBlock();
+		for (int i=edits.size()-1 ; i>=0 ; --i) {
+			cur.setPosition(edits[i].start);
+			cur.setPosition(edits[i].end, QTextCursor::KeepAnchor);
+			cur.insertText(edits[i].text);
+		}
+		cur.endEditBlock();
 	}
 
-	cur.endEditBlock();
 	on_editFind_textEdited();
+	ui->statusGrammar->showMessage(tr("%1 replacements in %2 ms").arg(count).arg(clock.elapsed()), 5000);
 }
 
 void GrammarEditor::on_editFind_returnPressed() {
 	on_actFindNext_triggered();
 }
 
+// Compiled again only when the text or the find options change, as this is used on every scroll
+const QRegularExpression& GrammarEditor::findRegex() {
+	auto text = ui->editFind->text();
+	auto key = QString("%1%2\t%3").arg(ui->optFindRegex->isChecked()).arg(ui->optFindCase->isChecked()).arg(text);
+	if (key != find_key) {
+		find_key = key;
+		if (!ui->optFindRegex->isChecked()) {
+			text = QRegularExpression::escape(text);
+		}
+		QRegularExpression::PatternOptions opts = QRegularExpression::InvertedGreedinessOption;
+		if (!ui->optFindCase->isChecked()) {
+			opts |= QRegularExpression::CaseInsensitiveOption;
+		}
+		find_rx.setPattern(text);
+		find_rx.setPatternOptions(opts);
+		find_rx.optimize();
+	}
+	return find_rx;
+}
+
 void GrammarEditor::on_editFind_textEdited() {
-	if (!ui->frameFindReplace->isVisible()) {
-		return;
+	if (!find_timer->isActive()) {
+		find_timer->start();
 	}
-	if (ui->editFind->text().isEmpty()) {
+}
+
+// Highlights matches in the blocks that are on screen, without copying any text out of the document
+void GrammarEditor::findHilite() {
+	findIndexReset();
+	if (!ui->frameFindReplace->isVisible()) {
+		findSelections.clear();
+		on_editGrammar_cursorPositionChanged();
 		return;
 	}
+	TRACE_SPAN("find highlight");
 	ui->editFind->setStyleSheet("");
 	ui->editFind->setToolTip("");
 
 	findSelections.clear();
-	auto p = ui->editFind->text();
-	if (!ui->optFindRegex->isChecked()) {
-		p = QRegularExpression::escape(p);
-	}
-	QRegularExpression::PatternOptions opts = QRegularExpression::InvertedGreedinessOption;
-	if (!ui->optFindCase->isChecked()) {
-		opts |= QRegularExpression::CaseInsensitiveOption;
+	if (ui->editFind->text().isEmpty()) {
+		on_editGrammar_cursorPositionChanged();
+		return;
 	}
-	QRegularExpression find(p, opts);
+	const auto& find = findRegex();
 	if (!find.isValid()) {
 		ui->editFind->setStyleSheet("background-color: #fbb");
 		ui->editFind->setToolTip(tr("Regex Error: ") + find.errorString());
+		on_editGrammar_cursorPositionChanged();
 		return;
 	}
 
@@ -1107,15 +1524,24 @@ void GrammarEditor::on_editFind_textEdited() {
 	selection.format.setBackground(lineColor);
 	selection.cursor = ui->editGrammar->textCursor();
 
-	auto s = ui->editGrammar->cursorForPosition(QPoint(0,0)), e = ui->editGrammar->cursorForPosition(QPoint(ui->editGrammar->viewport()->width(), ui->editGrammar->viewport()->height()));
-
-	auto text = ui->editGrammar->toPlainText().mid(s.position(), e.position() - s.position());
-	auto matches = find.globalMatch(text);
-	while (matches.hasNext()) {
-		auto match = matches.next();
-		selection.cursor.setPosition(s.position() + match.capturedStart(0));
-		selection.cursor.setPosition(s.position() + match.capturedEnd(0), QTextCursor::KeepAnchor);
-		findSelections.append(selection);
+	auto first = ui->editGrammar->cursorForPosition(QPoint(0,0)).block();
+	auto last = ui->editGrammar->cursorForPosition(QPoint(ui->editGrammar->viewport()->width(), ui->editGrammar->viewport()->height())).block();
+	for (auto block = first ; block.isValid() ; block = block.next()) {
+		if (block.isVisible()) {
+			auto matches = find.globalMatch(block.text());
+			while (matches.hasNext()) {
+				auto match = matches.next();
+				if (match.capturedLength(0) == 0) {
+					continue;
+				}
+				selection.cursor.setPosition(block.position() + match.capturedStart(0));
+				selection.cursor.setPosition(block.position() + match.capturedEnd(0), QTextCursor::KeepAnchor);
+				findSelections.append(selection);
+			}
+		}
+		if (block == last) {
+			break;
+		}
 	}
 
 	on_editGrammar_cursorPositionChanged();
@@ -1125,6 +1551,177 @@ void GrammarEditor::scrollValue_Changed(int) {
 	on_editFind_textEdited();
 }
 
+// Indexes all matches in the background when the pattern changes, or drops the index when there's nothing to find
+void GrammarEditor::findIndexReset() {
+	const auto& find = findRegex();
+	if (!ui->frameFindReplace->isVisible() || ui->editFind->text().isEmpty() || !find.isValid()) {
+		if (!find_index_key.isEmpty()) {
+			find_index_key.clear();
+			find_index->clear();
+			find_matches.clear();
+			find_gen_done = ++find_gen;
+			find_overview->setLines(QVector<int>(), 0);
+			ui->editGrammar->clearMarks(GrammarEdit::MARK_HIT);
+			findCount();
+		}
+		return;
+	}
+	if (find_index_key == find_key) {
+		return;
+	}
+	find_index_key = find_key;
+	find_pending_first = -1;
+	find_index_timer->stop();
+	find_lines = ui->editGrammar->document()->blockCount();
+	find_index->reset(find, ui->editGrammar->document()->toRawText(), ++find_gen);
+}
+
+// Notes which lines edits touched. They are sent to the index in one go a moment later,
+// as highlighting and typing both come as streams of small changes.
+void GrammarEditor::grammar_contentsChange(int pos, int, int added) {
+	auto doc = ui->editGrammar->document();
+	// Blocks the idle highlighting hasn't reached yet only have a placeholder state, so an edit there would be
+	// highlighted as if everything before it were plain text. Catch up to the edit first.
+	if (idle_timer->isActive()) {
+		auto last = doc->findBlock(std::min(pos + added, doc->characterCount() - 1)).blockNumber();
+		if (last >= hilite_next) {
+			auto block = doc->findBlockByNumber(hilite_next);
+			hilite_next = last + 1;
+			for ( ; block.isValid() && block.blockNumber() <= last ; block = block.next()) {
+				stxGrammar->rehighlightBlock(block);
+			}
+		}
+	}
+
+	if (find_index_key.isEmpty()) {
+		return;
+	}
+	int count = doc->blockCount();
+	int first = doc->findBlock(pos).blockNumber();
+	int last = doc->findBlock(std::min(pos + added, doc->characterCount() - 1)).blockNumber();
+	if (first < 0 || last < 0) {
+		find_index_key.clear();
+		findIndexReset();
+		return;
+	}
+	if (find_pending_first < 0) {
+		find_pending_first = first;
+		find_pending_last = last;
+	}
+	else {
+		// Pending lines after this edit moved by however many lines it added or removed
+		auto delta = count - find_pending_count;
+		find_pending_last = (find_pending_last >= first) ? std::max(find_pending_last + delta, last) : std::max(find_pending_last, last);
+		find_pending_first = std::min(find_pending_first, first);
+	}
+	find_pending_last = std::min(find_pending_last, count - 1);
+	find_pending_count = count;
+	++find_gen;
+	if (!find_index_timer->isActive()) {
+		find_index_timer->start();
+	}
+}
+
+// Lines after the pending range are unchanged, so the change in line count tells how many old lines the range replaces
+void GrammarEditor::findIndexFlush() {
+	if (find_pending_first < 0 || find_index_key.isEmpty()) {
+		find_pending_first = -1;
+		return;
+	}
+	auto doc = ui->editGrammar->document();
+	int count = doc->blockCount();
+	QStringList lines;
+	auto block = doc->findBlockByNumber(find_pending_first);
+	for (int i=find_pending_first ; i<=find_pending_last && block.isValid() ; ++i, block = block.next()) {
+		lines << block.text();
+	}
+	int removed = lines.size() - (count - find_lines);
+	int first = find_pending_first;
+	find_pending_first = -1;
+	if (removed < 0) {
+		find_index_key.clear();
+		findIndexReset();
+		return;
+	}
+	find_lines = count;
+	find_index->splice(first, removed, lines, find_gen);
+}
+
+void GrammarEditor::findIndex_indexed(int generation) {
+	if (generation != find_gen) {
+		// More edits are on the way, and these results would point at the wrong places
+		return;
+	}
+	find_matches = find_index->matches();
+	find_gen_done = generation;
+
+	QVector<int> lines;
+	lines.reserve(find_matches.size());
+	for (auto& m : find_matches) {
+		lines.append(m.line);
+	}
+	find_overview->setLines(lines, ui->editGrammar->document()->blockCount());
+	ui->editGrammar->setMarks(GrammarEdit::MARK_HIT, lines);
+	findCount();
+}
+
+static bool operator<(const FindMatch& a, const QPair<int,int>& b) {
+	return a.line < b.first || (a.line == b.first && a.column < b.second);
+}
+
+void GrammarEditor::findCount() {
+	if (find_index_key.isEmpty()) {
+		ui->lblFindCount->clear();
+		return;
+	}
+	if (find_gen_done != find_gen) {
+		return;
+	}
+
+	auto cur = ui->editGrammar->textCursor();
+	auto block = ui->editGrammar->document()->findBlock(cur.selectionStart());
+	auto at = qMakePair(block.blockNumber(), cur.selectionStart() - block.position());
+	auto it = std::lower_bound(find_matches.begin(), find_matches.end(), at);
+	if (it != find_matches.end() && it->line == at.first && it->column == at.second && it->length == cur.selectionEnd() - cur.selectionStart()) {
+		ui->lblFindCount->setText(tr("%1 of %2").arg(it - find_matches.begin() + 1).arg(find_matches.size()));
+	}
+	else {
+		ui->lblFindCount->setText(tr("%1 matches").arg(find_matches.size()));
+	}
+}
+
+// Jumps straight to the next or previous match using the index, when it's up to date. Returns false if it isn't.
+bool GrammarEditor::findJump(bool backward) {
+	if (find_index_key.isEmpty() || find_index_key != find_key || find_gen_done != find_gen) {
+		return false;
+	}
+	if (find_matches.isEmpty()) {
+		return true;
+	}
+
+	auto doc = ui->editGrammar->document();
+	auto cur = ui->editGrammar->textCursor();
+	auto pos = backward ? cur.selectionStart() : cur.selectionEnd();
+	auto block = doc->findBlock(pos);
+	auto at = qMakePair(block.blockNumber(), pos - block.position());
+	auto it = std::lower_bound(find_matches.begin(), find_matches.end(), at);
+	if (backward) {
+		it = (it == find_matches.begin()) ? find_matches.end() - 1 : it - 1;
+	}
+	else if (it == find_matches.end()) {
+		it = find_matches.begin();
+	}
+
+	auto target = doc->findBlockByNumber(it->line);
+	cur.setPosition(target.position() + it->column);
+	cur.setPosition(target.position() + it->column + it->length, QTextCursor::KeepAnchor);
+	ui->editGrammar->setTextCursor(cur);
+	ui->editGrammar->ensureCursorVisible();
+	ui->editGrammar->setFocus();
+	on_editFind_textEdited();
+	return true;
+}
+
 void GrammarEditor::sectionJump_Activated(int which) {
 	auto it = stxGrammar->section_lines.begin();
 	std::advance(it, which-1);
@@ -1225,21 +1822,53 @@ void GrammarEditor::on_btnRunProcess_clicked(bool) {
 		}
 		lines.pop_front();
 	}
-	if (!progs.empty()) {
-		params += QString("pipe\t") + progs.join(" | ") + "\n";
+	for (auto& prog : progs) {
+		params += QString("pipe\t") + prog + "\n";
 	}
 
 	if (!ui->editOutputPath->text().trimmed().isEmpty()) {
 		params += QString("output_file\t") + ui->editOutputPath->text().trimmed() + "\n";
 	}
 	params += QString("output_split\t") + settings.value("process/output_split", false).toString() + "\n";
+	params += QString("workers\t") + settings.value("process/workers", 1).toString() + "\n";
+	params += QString("chunk_size\t") + QString::number(settings.value("process/chunk_size", 0).toLongLong()*1024*1024) + "\n";
+	params += QString("log_lines\t") + settings.value("process/log_lines", 10000).toString() + "\n";
+	if (!settings.value("process/log_file").toString().isEmpty()) {
+		params += QString("log_file\t") + settings.value("process/log_file").toString() + "\n";
+	}
+	params += QString("memory_limit_mb\t") + settings.value("limits/memory_mb", 0).toString() + "\n";
+	params += QString("cpu_limit_s\t") + settings.value("limits/cpu_s", 0).toString() + "\n";
 
 	filePutContents(name, params);
-	if (!QProcess::startDetached(QDir(QCoreApplication::applicationDirPath()).filePath("cg3processor"), QStringList() << name)) {
+
+	// Jobs with a known destination go through the shared queue, so several windows don't oversubscribe the CPU.
+	// Without one, the Processor has to ask where to write, so it gets a window of its own.
+	// Only if nothing reached the queue does the job fall back to a window of its own, so it can never run twice.
+	if (!ui->editOutputPath->text().trimmed().isEmpty()) {
+		auto client = new QueueClient(name, 0, this);
+		connect(client, SIGNAL(refused(QString)), this, SLOT(queue_refused(QString)));
+		connect(client, SIGNAL(unreachable(QString)), this, SLOT(queue_unreachable(QString)));
+		connect(client, SIGNAL(lost(QString)), this, SLOT(queue_lost(QString)));
+		client->start();
+		return;
+	}
+	queue_unreachable(name);
+}
+
+void GrammarEditor::queue_refused(const QString& error) {
+	QMessageBox::critical(this, tr("Job refused!"), tr("The job queue refused the job: %1").arg(error));
+}
+
+void GrammarEditor::queue_unreachable(const QString& params) {
+	if (!QProcess::startDetached(QDir(QCoreApplication::applicationDirPath()).filePath("cg3processor"), QStringList() << params)) {
 		QMessageBox::information(this, tr("Spawning Processor failed!"), tr("Failed to spawn the Processor!"));
 	}
 }
 
+void GrammarEditor::queue_lost(const QString& params) {
+	QMessageBox::warning(this, tr("No answer from the job queue!"), tr("The job %1 was sent to the job queue, but the queue did not answer. Check the queue window before running it again.").arg(params));
+}
+
 void GrammarEditor::on_optPipeText_toggled(bool state) {
 	QSettings settings;
 	settingSetOrDef(settings, "process/pipe_text", true, state);
@@ -1447,6 +2076,15 @@ void GrammarEditor::on_editStdin_textChanged() {
 }
 
 void GrammarEditor::on_editInputFiles_textChanged() {
+	QStringList files;
+	for (auto& file : ui->editInputFiles->toPlainText().split('\n')) {
+		file = file.trimmed();
+		if (file.isEmpty() || file[0] == '#' || !QFileInfo::exists(file)) {
+			continue;
+		}
+		files << file;
+	}
+	FileWatcher::instance().setPaths(this, "inputs", files);
 	on_editStdin_textChanged();
 }
 
@@ -1454,7 +2092,13 @@ void GrammarEditor::on_editInputPipe_textChanged() {
 	on_editStdin_textChanged();
 }
 
-void GrammarEditor::on_editGrammar_modificationChanged(bool) {
+void GrammarEditor::on_editGrammar_modificationChanged(bool modified) {
+	if (modified) {
+		journal->checkpoint();
+	}
+	else {
+		journal->markClean();
+	}
 	reTitle();
 }
 
@@ -1470,8 +2114,10 @@ void GrammarEditor::on_editGrammar_textChanged() {
 }
 
 void GrammarEditor::on_editGrammar_blockCountChanged(int) {
+	// The table is left as is until the recheck, which only touches the rows that changed
 	errorSelections.clear();
-	errorEntries.clear();
+	ui->editGrammar->clearMarks(GrammarEdit::MARK_ERROR);
+	ui->editGrammar->clearMarks(GrammarEdit::MARK_WARNING);
 	on_editFind_textEdited();
 
 	hilite_timer->stop();
@@ -1480,15 +2126,15 @@ void GrammarEditor::on_editGrammar_blockCountChanged(int) {
 }
 
 void GrammarEditor::on_editGrammar_cursorPositionChanged() {
-	static auto otc = ui->editGrammar->cursorForPosition(QPoint(0,0));
-	const auto& ntc = ui->editGrammar->cursorForPosition(QPoint(0,0));
-	if (otc != ntc) {
-		otc = ntc;
-		on_editFind_textEdited();
+	// Only the diagnostics on screen are handed to the editor, so moving about costs the same however many there are.
+	// Scrolling and resizing rebuild this through findHilite(). One block back, as full line selections reach into the next.
+	QList<QTextEdit::ExtraSelection> extraSelections;
+	int first = ui->editGrammar->cursorForPosition(QPoint(0,0)).blockNumber();
+	int last = ui->editGrammar->cursorForPosition(QPoint(ui->editGrammar->viewport()->width(), ui->editGrammar->viewport()->height())).blockNumber();
+	for (auto it = errorSelections.lowerBound(first-1) ; it != errorSelections.end() && it.key() <= last ; ++it) {
+		extraSelections.append(it.value());
 	}
 
-	auto extraSelections = errorSelections;
-
 	QTextEdit::ExtraSelection selection;
 	auto lineColor = QColor(Qt::yellow).lighter(180);
 
@@ -1504,6 +2150,7 @@ void GrammarEditor::on_editGrammar_cursorPositionChanged() {
 
 	if (ui->frameFindReplace->isVisible()) {
 		extraSelections.append(findSelections);
+		findCount();
 	}
 
 	ui->editGrammar->setExtraSelections(extraSelections);
@@ -1516,3 +2163,26 @@ void GrammarEditor::on_editGrammar_cursorPositionChanged() {
 			   .arg(ui->editGrammar->document()->characterCount())
 			   );
 }
+
+// Tracing is per process, so every window's menu follows along
+void GrammarEditor::on_actTrace_toggled(bool state) {
+	for (auto w : QApplication::topLevelWidgets()) {
+		if (auto ge = qobject_cast<GrammarEditor*>(w)) {
+			QSignalBlocker block(ge->ui->actTrace);
+			ge->ui->actTrace->setChecked(state);
+		}
+	}
+
+	if (state) {
+		Trace::clear();
+		Trace::setEnabled(true);
+		return;
+	}
+
+	Trace::setEnabled(false);
+	auto filename = QFileDialog::getSaveFileName(this, tr("Save trace as..."), QString("cg3ide-trace-%1.json").arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")), tr("Chrome trace (*.json)"));
+	if (!filename.isEmpty() && !Trace::write(filename)) {
+		QMessageBox::information(this, tr("Save failed!"), tr("Failed to write the trace to %1!").arg(filename));
+	}
+	Trace::clear();
+}
@@ -24,6 +24,13 @@
 #define GRAMMAREDITOR_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
 
 #include "types.hpp"
+#include "DiagnosticsModel.hpp"
+#include "EditJournal.hpp"
+#include "FileWatcher.hpp"
+#include "FindIndex.hpp"
+#include "MatchOverview.hpp"
+#include "GrammarLoader.hpp"
+#include "GrammarSaver.hpp"
 #include "StreamHighlighter.hpp"
 #include "GrammarHighlighter.hpp"
 #include "OptionsDialog.hpp"
@@ -44,6 +51,7 @@ public:
 	void reOptions();
 	bool save(const QString& filename);
 	void open(const QString& filename);
+	void recover(const QString& filename, const QString& text);
 
 	bool eventFilter(QObject *watched, QEvent *event);
 
@@ -60,6 +68,20 @@ private slots:
 	void on_actHelp_triggered();
 
 	void reHilite();
+	void hiliteIdle();
+	void findHilite();
+	void findIndex_indexed(int);
+	void grammar_contentsChange(int, int, int);
+	void findIndexFlush();
+	void loader_decoded(const QString&, qint64);
+	void loader_failed(const QString&);
+	void loader_finished();
+	void load_canceled();
+	void saver_saved(const QString&, const QString&);
+	void watcher_filesChanged(const QStringList&);
+	void queue_refused(const QString&);
+	void queue_unreachable(const QString&);
+	void queue_lost(const QString&);
 
 	void checkGrammar_finished(int);
 	void previewOutRun_finished(int);
@@ -119,26 +141,63 @@ private slots:
 	void on_editGrammar_textChanged();
 	void on_editGrammar_blockCountChanged(int);
 	void on_editGrammar_cursorPositionChanged();
+	void on_actTrace_toggled(bool);
 
 public:
 	QScopedPointer<Ui::GrammarEditor> ui;
 	QScopedPointer<GrammarHighlighter> stxGrammar;
 
 private:
+	void loadAsync(const QString& filename);
+	void opened(const QString& filename);
+	void reSections();
+	void checkFileChanged();
+	void loadState(const QString& filename);
+	void watchFile(const QString& filename);
+	const QRegularExpression& findRegex();
+	void findIndexReset();
+	void findCount();
+	void addErrorSelection(const QTextEdit::ExtraSelection& selection);
+	void sizeErrorColumns();
+	bool findJump(bool backward);
+
 	QString defGrammar, lastGrammar;
 	QFileInfo cur_file;
 	QScopedPointer<QTimer> check_timer;
 	QScopedPointer<QTimer> hilite_timer;
+	QScopedPointer<QTimer> idle_timer;
+	QScopedPointer<QTimer> find_timer;
+	QRegularExpression find_rx;
+	QString find_key;
+	QScopedPointer<FindIndex> find_index;
+	MatchOverview *find_overview;
+	QVector<FindMatch> find_matches;
+	QString find_index_key;
+	int find_gen, find_gen_done, find_lines;
+	int find_pending_first, find_pending_last, find_pending_count;
+	QScopedPointer<QTimer> find_index_timer;
+	int hilite_next;
+	QScopedPointer<GrammarLoader> loader;
+	QScopedPointer<QProgressDialog> load_progress;
+	QScopedPointer<GrammarSaver> saver;
+	QScopedPointer<EditJournal> journal;
+	QStringList load_pending;
+	QString load_prev, load_error;
+	qint64 load_done;
+	bool load_prev_modified, load_busy, load_ended, load_cancel;
+	qint64 trace_load, trace_check, trace_preview;
 	CGChecker checker;
-	QList<QTextEdit::ExtraSelection> errorSelections, findSelections;
-	QStandardItemModel errorEntries;
+	QMap<int,QList<QTextEdit::ExtraSelection>> errorSelections;
+	QList<QTextEdit::ExtraSelection> findSelections;
+	DiagnosticsModel errorEntries;
 	QScopedPointer<StreamHighlighter> stxInput, stxInputPreview, stxOutput;
 	QRegularExpression rxTrace, rxReading, rxReading2;
 	QString stdout_raw;
 	QComboBox *section_jump;
 	bool previewIn_dirty, previewIn_run;
 	bool previewOut_run;
-	bool cur_file_check;
+	bool cur_file_check, cur_file_changed;
+	QVariantMap cur_state;
 };
 
 #endif // GRAMMAREDITOR_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
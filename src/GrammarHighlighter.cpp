@@ -20,12 +20,15 @@
 */
 
 #include "GrammarHighlighter.hpp"
+#include "Trace.hpp"
 #include "inlines.hpp"
 
 GrammarHighlighter::GrammarHighlighter(QTextDocument *parent) :
 	QSyntaxHighlighter(parent),
 	fmts(NUM_FORMATS),
-	fmt_desc(NUM_FORMATS)
+	fmt_desc(NUM_FORMATS),
+	state(nullptr),
+	deferred(false)
 {
 	fmt_desc[F_ERROR]	 << "error"	 << "Parse Errors"	  << "LIZT Nauns = errors abound ;"	 << "#ff0000" << "2" << "1";
 	fmt_desc[F_COMMENT]   << "comment"   << "Comments"		  << "# Comments with cats and dogs"	<< "#404040" << "1" << "1";
@@ -42,6 +45,11 @@ GrammarHighlighter::GrammarHighlighter(QTextDocument *parent) :
 	fmt_desc[F_OPTIONAL]  << "optional"  << "Optional Keywords" << "SETS, TARGET, IF, END, etc"	   << "#808080" << "1" << "1";
 }
 
+// While deferred, blocks only get an empty state, and are expected to be highlighted later with rehighlightBlock()
+void GrammarHighlighter::setDeferred(bool d) {
+	deferred = d;
+}
+
 void GrammarHighlighter::clear() {
 	set_lines.clear();
 	tmpl_lines.clear();
@@ -81,6 +89,13 @@ bool GrammarHighlighter::SKIPTOWS(const QChar *& p, const QChar a, const bool al
 }
 
 void GrammarHighlighter::highlightBlock(const QString& text) {
+	TRACE_SPAN("highlight block");
+	if (deferred) {
+		// Everything that looks at blocks expects each to have a state
+		setCurrentBlockUserData(new GrammarState(QVector<State>() << S_NONE));
+		return;
+	}
+
 	auto s = static_cast<GrammarState*>(currentBlock().previous().userData());
 	if (s) {
 		state = new GrammarState(*s);
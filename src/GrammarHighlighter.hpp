@@ -36,6 +36,8 @@ public:
 	QMap<QString,int> tmpl_lines;
 	std::set<int> section_lines;
 
+	void setDeferred(bool);
+
 public slots:
 	void clear();
 
@@ -75,6 +77,7 @@ private:
 	inline bool parseNone(const QString& text, const QChar *& p);
 
 	GrammarState *state;
+	bool deferred;
 };
 
 #endif // GRAMMARHIGHLIGHTER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
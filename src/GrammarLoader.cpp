@@ -0,0 +1,101 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GrammarLoader.hpp"
+#include "Trace.hpp"
+#include "inlines.hpp"
+#include <algorithm>
+
+// Small enough that inserting one slice doesn't stall the event loop noticeably
+constexpr qint64 DECODE_SLICE = 1 << 18;
+
+GrammarLoader::GrammarLoader(const QString& filename, QObject *parent) :
+	QThread(parent),
+	filename(filename),
+	total(QFileInfo(filename).size())
+{
+}
+
+GrammarLoader::~GrammarLoader() {
+	requestInterruption();
+	wait();
+}
+
+const QString& GrammarLoader::fileName() const {
+	return filename;
+}
+
+qint64 GrammarLoader::size() const {
+	return total;
+}
+
+void GrammarLoader::run() {
+	TraceSpan span("decode grammar");
+	span.setDetail(filename);
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly)) {
+		emit failed(tr("Failed to open %1 for reading!").arg(filename));
+		return;
+	}
+
+	// Reading is the fallback for files that can't be mapped, such as some network mounts
+	auto map = total > 0 ? file.map(0, total) : nullptr;
+	QByteArray buffer;
+
+	// Same as fileGetContents: UTF-8 unless a byte order mark says otherwise
+	QScopedPointer<QTextDecoder> decoder;
+	QString cr;
+	for (qint64 done = 0 ; done < total && !isInterruptionRequested() ; ) {
+		auto n = std::min(DECODE_SLICE, total - done);
+		const char *data = nullptr;
+		if (map) {
+			data = reinterpret_cast<const char*>(map + done);
+		}
+		else {
+			buffer = file.read(n);
+			if (buffer.isEmpty()) {
+				emit failed(tr("Failed to read %1: %2").arg(filename).arg(file.errorString()));
+				return;
+			}
+			n = buffer.size();
+			data = buffer.constData();
+		}
+
+		if (!decoder) {
+			auto codec = QTextCodec::codecForUtfText(QByteArray::fromRawData(data, static_cast<int>(n)), QTextCodec::codecForName("UTF-8"));
+			decoder.reset(codec->makeDecoder());
+		}
+		// The decoder carries partial characters over to the next slice
+		auto text = cr + decoder->toUnicode(data, static_cast<int>(n));
+		done += n;
+		cr.clear();
+		// A \r\n split between slices would become two line breaks, so a trailing \r waits for what follows it
+		if (done < total && text.endsWith('\r')) {
+			text.chop(1);
+			cr = "\r";
+		}
+		emit decoded(text, done);
+	}
+
+	if (map) {
+		file.unmap(map);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef GRAMMARLOADER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define GRAMMARLOADER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+
+// Maps a grammar file and decodes it on its own thread, handing the text over in slices
+// so the editor can build its document a piece at a time without freezing.
+class GrammarLoader : public QThread {
+	Q_OBJECT
+
+public:
+	GrammarLoader(const QString& filename, QObject *parent = nullptr);
+	~GrammarLoader();
+
+	const QString& fileName() const;
+	qint64 size() const;
+
+signals:
+	void decoded(const QString&, qint64);
+	void failed(const QString&);
+
+protected:
+	void run() override;
+
+private:
+	QString filename;
+	qint64 total;
+};
+
+#endif // GRAMMARLOADER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -0,0 +1,133 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GrammarSaver.hpp"
+#include "Trace.hpp"
+
+GrammarSaver::GrammarSaver(QObject *parent) :
+	QThread(parent),
+	busy(false),
+	stopping(false)
+{
+}
+
+// Whatever was asked to be saved still gets saved
+GrammarSaver::~GrammarSaver() {
+	{
+		QMutexLocker lock(&mutex);
+		stopping = true;
+		wake.wakeAll();
+	}
+	wait();
+}
+
+// The text is implicitly shared, so taking the snapshot costs the GUI thread one toPlainText().
+// A save queued right behind another one to the same file replaces it, as only the newest text matters.
+void GrammarSaver::save(const QString& filename, const QString& text, const QVariantMap& state) {
+	QMutexLocker lock(&mutex);
+	if (!queue.isEmpty() && queue.back().filename == filename) {
+		queue.back().text = text;
+		queue.back().state = state;
+	}
+	else {
+		queue.enqueue(Request{filename, text, state});
+	}
+	busy = true;
+	wake.wakeAll();
+	if (!isRunning()) {
+		start();
+	}
+}
+
+bool GrammarSaver::isBusy() const {
+	QMutexLocker lock(&mutex);
+	return busy;
+}
+
+// Blocks until everything queued is on disk, and returns the last error since the previous call, if any
+QString GrammarSaver::waitForIdle() {
+	QMutexLocker lock(&mutex);
+	while (busy) {
+		idle.wait(&mutex);
+	}
+	QString rv;
+	rv.swap(error);
+	return rv;
+}
+
+void GrammarSaver::run() {
+	QMutexLocker lock(&mutex);
+	forever {
+		while (queue.isEmpty() && !stopping) {
+			busy = false;
+			idle.wakeAll();
+			wake.wait(&mutex);
+		}
+		if (queue.isEmpty()) {
+			break;
+		}
+		auto r = queue.dequeue();
+		lock.unlock();
+		auto e = write(r);
+		lock.relock();
+		if (!e.isEmpty()) {
+			error = e;
+		}
+		emit saved(r.filename, e);
+	}
+	busy = false;
+	idle.wakeAll();
+}
+
+QString GrammarSaver::write(const Request& r) {
+	TraceSpan span("write grammar");
+	span.setDetail(r.filename);
+	QSaveFile file(r.filename);
+	// Some shares let a file be written but not created next to, and a direct write still beats not saving
+	file.setDirectWriteFallback(true);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return tr("Failed to open %1 for writing: %2").arg(r.filename).arg(file.errorString());
+	}
+	auto data = r.text.toUtf8();
+	if (file.write(data) != data.size() || !file.commit()) {
+		return tr("Failed to write %1: %2").arg(r.filename).arg(file.errorString());
+	}
+
+	// Project state rarely changes between saves, so it's only rewritten when it did
+	auto cg3p = r.filename + ".cg3p";
+	if (cg3p == state_name && r.state == state_last) {
+		return QString();
+	}
+	QFileInfo info(cg3p);
+	if (!info.exists() || info.isWritable()) {
+		QSettings state(cg3p, QSettings::Format::IniFormat);
+		for (auto it = r.state.begin() ; it != r.state.end() ; ++it) {
+			state.setValue(it.key(), it.value());
+		}
+		state.sync();
+		if (state.status() != QSettings::NoError) {
+			return tr("Failed to write project state to %1").arg(cg3p);
+		}
+		state_name = cg3p;
+		state_last = r.state;
+	}
+	return QString();
+}
@@ -0,0 +1,66 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef GRAMMARSAVER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define GRAMMARSAVER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+
+// Writes grammar snapshots and their .cg3p project state on its own thread.
+// Grammars go through QSaveFile, so the file on disk is either the old or the new one, never a truncated mix.
+class GrammarSaver : public QThread {
+	Q_OBJECT
+
+public:
+	explicit GrammarSaver(QObject *parent = nullptr);
+	~GrammarSaver();
+
+	void save(const QString& filename, const QString& text, const QVariantMap& state);
+	bool isBusy() const;
+	QString waitForIdle();
+
+signals:
+	void saved(const QString&, const QString&);
+
+protected:
+	void run() override;
+
+private:
+	struct Request {
+		QString filename;
+		QString text;
+		QVariantMap state;
+	};
+	QString write(const Request&);
+
+	mutable QMutex mutex;
+	QWaitCondition wake, idle;
+	QQueue<Request> queue;
+	bool busy, stopping;
+	QString error;
+
+	// Only touched from the saving thread
+	QString state_name;
+	QVariantMap state_last;
+};
+
+#endif // GRAMMARSAVER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
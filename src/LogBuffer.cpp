@@ -0,0 +1,113 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LogBuffer.hpp"
+
+constexpr int LOG_FLUSH_MS = 250;
+
+// Lines that differ only in numbers, such as line numbers or worker IDs, count as similar
+static QString similarKey(const QString& line) {
+	QString key;
+	key.reserve(line.size());
+	bool digits = false;
+	for (auto c : line) {
+		if (c.isDigit()) {
+			if (!digits) {
+				key += '#';
+			}
+			digits = true;
+		}
+		else {
+			key += c;
+			digits = false;
+		}
+	}
+	return key;
+}
+
+LogBuffer::LogBuffer(QPlainTextEdit *view, int max_lines) :
+	QObject(view),
+	view(view),
+	similar(0),
+	dropped(0),
+	max_lines(0)
+{
+	setMaxLines(max_lines);
+	timer.setInterval(LOG_FLUSH_MS);
+	connect(&timer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+void LogBuffer::setMaxLines(int n) {
+	max_lines = std::max(n, 1);
+	// The document itself then acts as the ring buffer, dropping its oldest blocks as new ones come in
+	view->setMaximumBlockCount(max_lines);
+}
+
+void LogBuffer::append(const QString& line) {
+	auto key = similarKey(line);
+	if (key == last_key) {
+		++similar;
+	}
+	else {
+		if (similar) {
+			note(tr("… %1 similar lines").arg(QLocale().toString(similar)));
+			similar = 0;
+		}
+		last_key = key;
+		note(line);
+	}
+	if (!timer.isActive()) {
+		timer.start();
+	}
+}
+
+void LogBuffer::note(const QString& line) {
+	// Nothing past what the view will keep is worth holding on to
+	if (pending.size() >= max_lines) {
+		pending.removeFirst();
+		++dropped;
+	}
+	pending.append(line);
+}
+
+void LogBuffer::flush() {
+	// Report a run of similar lines once per flush even while it's still going, so a long run doesn't look like a hang
+	if (similar) {
+		note(tr("… %1 similar lines").arg(QLocale().toString(similar)));
+		similar = 0;
+	}
+	if (dropped) {
+		pending.prepend(tr("… %1 lines not shown").arg(QLocale().toString(dropped)));
+		dropped = 0;
+	}
+	if (pending.isEmpty()) {
+		timer.stop();
+		return;
+	}
+
+	auto bar = view->verticalScrollBar();
+	bool follow = (bar->value() == bar->maximum());
+	view->appendPlainText(pending.join('\n'));
+	pending.clear();
+	if (follow) {
+		bar->setValue(bar->maximum());
+	}
+}
@@ -0,0 +1,81 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MatchOverview.hpp"
+
+MatchOverview::MatchOverview(QScrollBar *bar) :
+	QWidget(bar),
+	total(0)
+{
+	setAttribute(Qt::WA_TransparentForMouseEvents);
+	setGeometry(bar->rect());
+	bar->installEventFilter(this);
+}
+
+// Lines are block numbers, and need not be unique or sorted
+void MatchOverview::setLines(const QVector<int>& ls, int t) {
+	lines = ls;
+	total = t;
+	setVisible(!lines.isEmpty());
+	update();
+}
+
+bool MatchOverview::eventFilter(QObject *watched, QEvent *event) {
+	if (watched == parent() && event->type() == QEvent::Resize) {
+		setGeometry(parentWidget()->rect());
+	}
+	return false;
+}
+
+void MatchOverview::paintEvent(QPaintEvent*) {
+	if (lines.isEmpty() || total <= 0) {
+		return;
+	}
+
+	// Keep clear of the arrow buttons, so ticks line up with the groove the handle moves in
+	auto bar = qobject_cast<QScrollBar*>(parentWidget());
+	QStyleOptionSlider opt;
+	opt.initFrom(bar);
+	opt.orientation = bar->orientation();
+	opt.minimum = bar->minimum();
+	opt.maximum = bar->maximum();
+	opt.sliderPosition = bar->sliderPosition();
+	opt.sliderValue = bar->value();
+	opt.pageStep = bar->pageStep();
+	opt.singleStep = bar->singleStep();
+	auto groove = bar->style()->subControlRect(QStyle::CC_ScrollBar, &opt, QStyle::SC_ScrollBarGroove, bar);
+	if (groove.height() <= 0) {
+		groove = rect();
+	}
+
+	QPainter painter(this);
+	auto color = QColor(Qt::green).darker(130);
+	int last = -1;
+	for (auto line : lines) {
+		int y = groove.top() + static_cast<int>(static_cast<qint64>(groove.height()) * line / total);
+		// Many matches land on the same pixel row in big grammars
+		if (y == last) {
+			continue;
+		}
+		painter.fillRect(groove.left() + 2, y, groove.width() - 4, 2, color);
+		last = y;
+	}
+}
@@ -21,6 +21,7 @@
 
 #include "OptionsDialog.hpp"
 #include "GrammarEditor.hpp"
+#include "CG3Detector.hpp"
 #include "ui_GrammarEditor.h"
 #include "ui_OptionsDialog.h"
 #include "inlines.hpp"
@@ -40,6 +41,12 @@ OptionsDialog::OptionsDialog(QWidget *parent) :
 	ui->optLiveDelay->setText(settings.value("cg3/livedelay", 2000).toString());
 	ui->optMaxInputLines->setText(settings.value("cg3/maxinputlines", 1000).toString());
 	ui->optMaxInputChars->setText(settings.value("cg3/maxinputchars", 60000).toString());
+	ui->optWorkers->setText(settings.value("process/workers", 1).toString());
+	ui->optChunkSize->setText(settings.value("process/chunk_size", 0).toString());
+	ui->optLogLines->setText(settings.value("process/log_lines", 10000).toString());
+	ui->optLogFile->setText(settings.value("process/log_file", "").toString());
+	ui->optLimitMemory->setText(settings.value("limits/memory_mb", 0).toString());
+	ui->optLimitCpu->setText(settings.value("limits/cpu_s", 0).toString());
 
 	bin_auto = settings.value("cg3/autodetect", true).toBool();
 	updateRevision(settings.value("cg3/binary", "").toString());
@@ -117,6 +124,17 @@ void OptionsDialog::accept() {
 	settingSetOrDef(settings, "cg3/maxinputlines", 1000, lines);
 	int chars = std::max(ui->optMaxInputChars->text().trimmed().toInt(), 500);
 	settingSetOrDef(settings, "cg3/maxinputchars", 60000, chars);
+	int workers = std::max(ui->optWorkers->text().trimmed().toInt(), 1);
+	settingSetOrDef(settings, "process/workers", 1, workers);
+	int chunk = std::max(ui->optChunkSize->text().trimmed().toInt(), 0);
+	settingSetOrDef(settings, "process/chunk_size", 0, chunk);
+	int log_lines = std::max(ui->optLogLines->text().trimmed().toInt(), 100);
+	settingSetOrDef(settings, "process/log_lines", 10000, log_lines);
+	settingSetOrDef(settings, "process/log_file", QString(""), ui->optLogFile->text().trimmed());
+	int memory = std::max(ui->optLimitMemory->text().trimmed().toInt(), 0);
+	settingSetOrDef(settings, "limits/memory_mb", 0, memory);
+	int cpu = std::max(ui->optLimitCpu->text().trimmed().toInt(), 0);
+	settingSetOrDef(settings, "limits/cpu_s", 0, cpu);
 
 	settingSetOrDef(settings, "editor/font", QString(""), ui->editFont->font().toString());
 
@@ -129,7 +147,12 @@ void OptionsDialog::accept() {
 		settingSetOrDef(settings, QString("editor/highlight_%1_italic").arg(desc[0]), QVariant(desc[4]).toInt(), static_cast<int>(itas[i]->checkState()));
 	}
 
-	dynamic_cast<GrammarEditor*>(parent())->reOptions();
+	// All windows live in this process and read the same settings
+	for (auto w : QApplication::topLevelWidgets()) {
+		if (auto ge = qobject_cast<GrammarEditor*>(w)) {
+			ge->reOptions();
+		}
+	}
 
 	close();
 }
@@ -208,7 +231,7 @@ void OptionsDialog::on_btnBinaryManual_clicked(bool) {
 void OptionsDialog::on_btnBinaryAuto_clicked(bool) {
 	bin_auto = true;
 
-	auto latest = findLatestCG3();
+	auto latest = CG3Detector::findLatest();
 	if (latest.isEmpty()) {
 		QMessageBox::information(this, tr("No CG-3 binary!"), tr("Could not locate a suitable CG-3 binary in $PATH or custom locations!"));
 		return;
@@ -0,0 +1,159 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProcessLimits.hpp"
+#include "inlines.hpp"
+#if defined(Q_OS_UNIX)
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+
+constexpr int WATCHDOG_MS = 250;
+
+ProcessLimits limitsFromSettings() {
+	QSettings settings;
+	ProcessLimits lim;
+	lim.memory_kb = settings.value("limits/memory_mb", 0).toLongLong() * 1024;
+	lim.cpu_ms = settings.value("limits/cpu_s", 0).toLongLong() * 1000;
+	return lim;
+}
+
+#if defined(Q_OS_UNIX)
+// Runs in the child between fork and exec, so may only do async-signal-safe things
+static void applyRlimits(rlim_t as, rlim_t cpu) {
+	struct rlimit rl;
+	if (as) {
+		rl.rlim_cur = rl.rlim_max = as;
+		setrlimit(RLIMIT_AS, &rl);
+	}
+	if (cpu) {
+		rl.rlim_cur = cpu;
+		rl.rlim_max = cpu + 5;
+		setrlimit(RLIMIT_CPU, &rl);
+	}
+}
+
+// The backstops sit well above the real limits, so the watchdog gets to kill first and say why.
+// Address space is always larger than RSS, so twice the memory limit only stops runaway growth.
+static rlim_t backstopAs(const ProcessLimits& lim) {
+	return lim.memory_kb > 0 ? static_cast<rlim_t>(lim.memory_kb) * 1024 * 2 : 0;
+}
+
+static rlim_t backstopCpu(const ProcessLimits& lim) {
+	return lim.cpu_ms > 0 ? static_cast<rlim_t>(lim.cpu_ms / 1000 + 10) : 0;
+}
+#endif
+
+// Current RSS and CPU time of a live child, where the OS makes that cheap to get
+static bool sampleUsage(qint64 pid, qint64& rss_kb, qint64& cpu_ms) {
+#if defined(Q_OS_LINUX)
+	QFile stat(QString("/proc/%1/stat").arg(pid));
+	if (!stat.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	// Fields after the parenthesised command name, which may itself contain spaces
+	auto line = stat.readAll();
+	auto fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+	if (fields.size() < 22) {
+		return false;
+	}
+	static const qint64 ticks = sysconf(_SC_CLK_TCK);
+	static const qint64 page_kb = sysconf(_SC_PAGESIZE) / 1024;
+	cpu_ms = (fields[11].toLongLong() + fields[12].toLongLong()) * 1000 / ticks;
+	rss_kb = fields[21].toLongLong() * page_kb;
+	return true;
+#else
+	Q_UNUSED(pid);
+	Q_UNUSED(rss_kb);
+	Q_UNUSED(cpu_ms);
+	return false;
+#endif
+}
+
+LimitedProcess::LimitedProcess(QObject *parent) :
+	QProcess(parent)
+{
+	watchdog.setInterval(WATCHDOG_MS);
+	connect(&watchdog, SIGNAL(timeout()), this, SLOT(check()));
+	connect(this, SIGNAL(started()), this, SLOT(process_started()));
+	connect(this, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(process_finished()));
+}
+
+LimitedProcess::~LimitedProcess() {
+}
+
+void LimitedProcess::setLimits(const ProcessLimits& limits) {
+	lim = limits;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0) && defined(Q_OS_UNIX)
+	auto as = backstopAs(lim);
+	auto cpu = backstopCpu(lim);
+	setChildProcessModifier([as, cpu]() {
+		applyRlimits(as, cpu);
+	});
+#endif
+}
+
+const ProcessLimits& LimitedProcess::limits() const {
+	return lim;
+}
+
+// Why the child was killed, or empty if it wasn't killed for going over a limit
+const QString& LimitedProcess::breach() const {
+	return breach_text;
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+void LimitedProcess::setupChildProcess() {
+#if defined(Q_OS_UNIX)
+	applyRlimits(backstopAs(lim), backstopCpu(lim));
+#endif
+}
+#endif
+
+void LimitedProcess::process_started() {
+	breach_text.clear();
+	if (lim.isSet()) {
+		watchdog.start();
+	}
+}
+
+void LimitedProcess::process_finished() {
+	watchdog.stop();
+}
+
+void LimitedProcess::check() {
+	qint64 rss_kb = 0, cpu_ms = 0;
+	if (state() != QProcess::Running || !sampleUsage(processId(), rss_kb, cpu_ms)) {
+		return;
+	}
+	if (lim.memory_kb > 0 && rss_kb > lim.memory_kb) {
+		breach_text = tr("killed at %1 RSS (limit %2)").arg(formatBytes(rss_kb * 1024.0)).arg(formatBytes(lim.memory_kb * 1024.0));
+	}
+	else if (lim.cpu_ms > 0 && cpu_ms > lim.cpu_ms) {
+		breach_text = tr("killed after %1 s of CPU time (limit %2 s)").arg(cpu_ms / 1000.0, 0, 'f', 1).arg(lim.cpu_ms / 1000);
+	}
+	else {
+		return;
+	}
+	watchdog.stop();
+	kill();
+	emit limitExceeded(breach_text);
+}
@@ -0,0 +1,73 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef PROCESSLIMITS_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define PROCESSLIMITS_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+
+// How much a CG-3 child may use before it is killed. Zero means no limit.
+struct ProcessLimits {
+	qint64 memory_kb = 0;
+	qint64 cpu_ms = 0;
+
+	bool isSet() const {
+		return memory_kb > 0 || cpu_ms > 0;
+	}
+};
+
+ProcessLimits limitsFromSettings();
+
+// A QProcess that is killed when its child goes over its limits, instead of dragging the whole machine into swap.
+// The child is watched from here so a breach can be told apart from an ordinary crash and reported in plain words,
+// and on POSIX it also gets looser rlimits as a backstop for growth faster than the watchdog samples.
+class LimitedProcess : public QProcess {
+	Q_OBJECT
+
+public:
+	explicit LimitedProcess(QObject *parent = nullptr);
+	~LimitedProcess();
+
+	void setLimits(const ProcessLimits&);
+	const ProcessLimits& limits() const;
+	const QString& breach() const;
+
+signals:
+	void limitExceeded(const QString&);
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+protected:
+	void setupChildProcess() override;
+#endif
+
+private slots:
+	void process_started();
+	void process_finished();
+	void check();
+
+private:
+	ProcessLimits lim;
+	QTimer watchdog;
+	QString breach_text;
+};
+
+#endif // PROCESSLIMITS_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -21,18 +21,23 @@
 
 #include "Processor.hpp"
 #include "ui_Processor.h"
+#include "LogBuffer.hpp"
+#include "ProcessorQueue.hpp"
+#include "QueueClient.hpp"
+#include "QueueMonitor.hpp"
+#include "Trace.hpp"
 #include "inlines.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
-Processor::Processor(const QString& paramname) :
-	ui(new Ui::Processor),
-	input_buffer(32768, 0),
-	input_size(0),
-	input_offset(0),
-	split(false)
+Processor::Processor(const QString& paramname, bool resume) :
+	ui(new Ui::Processor)
 {
 	ui->setupUi(this);
 
 	ui->prgProgress->hide();
+	ui->lblStages->hide();
 	ui->editLogPipe->hide();
 
 	int tabwidth = QFontMetrics(ui->editLog->document()->defaultFont()).horizontalAdvance('x')*3;
@@ -40,42 +45,30 @@ Processor::Processor(const QString& paramname) :
 	ui->editLogPipe->setTabStopDistance(tabwidth);
 	ui->editLogCG->setTabStopDistance(tabwidth);
 
-	QFile paramf(paramname);
-	if (!paramf.open(QIODevice::ReadOnly)) {
+	auto log = new LogBuffer(ui->editLog, job.logLines());
+	auto logCG = new LogBuffer(ui->editLogCG, job.logLines());
+	auto logPipe = new LogBuffer(ui->editLogPipe, job.logLines());
+	connect(&job, SIGNAL(log(QString)), log, SLOT(append(QString)));
+	connect(&job, SIGNAL(logCG(QString)), logCG, SLOT(append(QString)));
+	connect(&job, SIGNAL(logPipe(QString)), logPipe, SLOT(append(QString)));
+	connect(&job, SIGNAL(statsUpdated()), this, SLOT(job_statsUpdated()));
+
+	if (!job.loadParams(paramname)) {
 		QMessageBox::critical(nullptr, tr("Bad Param Data!"), tr("Could not read %1!").arg(paramname));
 		throw(-1);
 	}
-
-	QTextStream paramt(&paramf);
-	setEncoding(paramt);
-
-	while (!paramt.atEnd()) {
-		auto tmp = paramt.readLine();
-		tmp = tmp.trimmed();
-		if (!tmp.isEmpty() && tmp.at(0) != '#' && tmp.contains('\t')) {
-			auto ls = tmp.split('\t');
-			if (ls.at(0) == "binary") {
-				setBinary(ls.at(1));
-			}
-			else if (ls.at(0) == "grammar") {
-				setGrammar(ls.at(1));
-			}
-			else if (ls.at(0) == "inputs") {
-				auto ss = ls.at(1).split("|");
-				for (auto& s : ss) {
-					addInputFile(s);
-				}
-			}
-			else if (ls.at(0) == "pipe") {
-				setPipe(ls.at(1));
-			}
-			else if (ls.at(0) == "output_file") {
-				setOutputFile(ls.at(1));
-			}
-			else if (ls.at(0) == "output_split") {
-				setOutputSplit(QVariant(ls.at(1)).toBool());
-			}
-		}
+	// The params decide how much the views keep, but lines logged while loading them must not be lost
+	log->setMaxLines(job.logLines());
+	logCG->setMaxLines(job.logLines());
+	logPipe->setMaxLines(job.logLines());
+	job.setResume(resume);
+
+	if (!job.inputFiles().empty()) {
+		// Permille rather than bytes, as the total can be past what an int holds
+		ui->prgProgress->setMaximum(1000);
+		ui->prgProgress->setValue(0);
+		ui->prgProgress->setFormat("%p%");
+		ui->prgProgress->show();
 	}
 
 	setWindowTitle(QFileInfo(paramname).fileName() + tr(" - CG-3 IDE Processor"));
@@ -89,242 +82,243 @@ void Processor::closeEvent(QCloseEvent *event) {
 	QWidget::closeEvent(event);
 }
 
-bool Processor::addInputFile(const QString& name) {
-	QFileInfo info(name);
-	if (info.exists() && info.isReadable() && info.isFile()) {
-		inputs.append(info);
-		input_size += info.size();
-		ui->prgProgress->setMaximum(input_size);
-		ui->prgProgress->show();
-		ui->editLog->appendPlainText(tr("Added file %1 as input").arg(name));
-		return true;
-	}
-	return false;
-}
-
-void Processor::setBinary(const QString& b) {
-	binary = b;
-}
-
-void Processor::setGrammar(const QString& g) {
-	args = QStringList() << "-v" << "-g" << g;
-}
-
-void Processor::setPipe(const QString& p) {
-	pipes = p;
-}
-
-void Processor::setOutputFile(const QString& o) {
-	output_name = o;
-}
-
-void Processor::setOutputSplit(bool state) {
-	split = state;
-}
-
 void Processor::doIt() {
-	if (output_name.isEmpty()) {
-		output_name = QFileDialog::getSaveFileName(this, tr("Output To"), inputs.empty() ? "" : inputs.front().filePath(), tr("Any File (*.*)"));
+	if (job.outputFile().isEmpty()) {
+		auto output_name = QFileDialog::getSaveFileName(this, tr("Output To"), job.inputFiles().empty() ? "" : job.inputFiles().front().filePath(), tr("Any File (*.*)"));
 		if (output_name.isEmpty()) {
 			QMessageBox::critical(this, tr("Output to nowhere?"), tr("You must select somewhere to output to."));
 			close();
 			return;
 		}
+		job.setOutputFile(output_name);
 	}
 
-	process.reset(new QProcess);
-	connect(process.data(), SIGNAL(started()), this, SLOT(process_started()));
-	connect(process.data(), SIGNAL(error(QProcess::ProcessError)), this, SLOT(process_error(QProcess::ProcessError)));
-	connect(process.data(), SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(process_finished(int,QProcess::ExitStatus)));
-	connect(process.data(), SIGNAL(readyReadStandardOutput()), this, SLOT(process_readyReadStandardOutput()));
-	connect(process.data(), SIGNAL(readyReadStandardError()), this, SLOT(process_readyReadStandardError()));
-	process->setWorkingDirectory(QDir::tempPath());
-
-	if (!pipes.isEmpty()) {
+	if (job.hasPipe()) {
 		ui->editLogPipe->show();
-		pipe.reset(new QProcess);
-		connect(pipe.data(), SIGNAL(started()), this, SLOT(pipe_started()));
-		connect(pipe.data(), SIGNAL(error(QProcess::ProcessError)), this, SLOT(pipe_error(QProcess::ProcessError)));
-		connect(pipe.data(), SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(pipe_finished(int,QProcess::ExitStatus)));
-		connect(pipe.data(), SIGNAL(readyReadStandardError()), this, SLOT(readyReadStandardError()));
-		pipe->setWorkingDirectory(QDir::tempPath());
-		pipe->setStandardOutputProcess(process.data());
-		#if defined(Q_OS_WIN)
-		pipe->start("cmd", QStringList() << "/D" << "/Q" << "/C" << pipes);
-		#else
-		pipe->start("/bin/sh", QStringList() << "-c" << pipes);
-		#endif
 	}
 
-	process->start(binary, args);
+	job.start();
+}
 
-	if (!inputs.empty()) {
-		timer.reset(new QTimer);
-		connect(timer.data(), SIGNAL(timeout()), this, SLOT(timer_timeout()));
-		timer->setSingleShot(true);
-		timer->start(100);
-	}
+void Processor::on_btnAbort_clicked(bool) {
+	job.abort();
+}
+
+void Processor::on_btnAbortForce_clicked(bool) {
+	job.kill();
 }
 
-void Processor::timer_timeout() {
-	auto p = pipe ? pipe.data() : process.data();
+void Processor::on_btnClose_clicked(bool) {
+	on_btnAbortForce_clicked(true);
+	close();
+}
 
-	if (p->state() == 0) {
-		ui->editLog->appendPlainText(tr("The pipe / process ended prematurely"));
-		return;
+void Processor::job_statsUpdated() {
+	auto& st = job.stats();
+	if (st.bytes_total > 0) {
+		ui->prgProgress->setValue(static_cast<int>(std::min(st.bytes_in * 1000 / st.bytes_total, qint64(1000))));
 	}
 
-	if (input.isOpen()) {
-		qint64 pos = 0;
-		if ((pos = input.read(&input_buffer.data()[input_offset], input_buffer.size()-input_offset)) == 0) {
-			if (split) {
-				input_buffer.append("\n<STREAMCMD:FLUSH>\n");
+	auto text = tr("%p% - in %1/s, out %2/s, %3 cohorts/s").arg(formatBytes(st.rate_in)).arg(formatBytes(st.rate_out)).arg(st.rate_cohorts, 0, 'f', 0);
+	if (st.file >= 0) {
+		text += tr(" - %1 %2, ETA %3").arg(job.inputFiles()[st.file].fileName()).arg(formatTime(st.file_elapsed_ms)).arg(formatTime(st.file_eta_ms));
+	}
+	text += tr(" - total %1, ETA %2").arg(formatTime(st.elapsed_ms)).arg(formatTime(st.eta_ms));
+	if (st.cpu_ms) {
+		text += tr(" - CPU %1 s, peak RSS %2").arg(st.cpu_ms / 1000.0, 0, 'f', 1).arg(formatBytes(st.peak_rss_kb * 1024.0));
+	}
+	ui->prgProgress->setFormat(text);
+
+	if (st.stages.size() > 1) {
+		QStringList lines;
+		for (int i=0 ; i<st.stages.size() ; ++i) {
+			auto& s = st.stages[i];
+			auto line = tr("%1 %2: in %3/s, out %4/s, CPU %5 s").arg(i+1).arg(s.command.section(' ', 0, 0)).arg(formatBytes(s.rate_in)).arg(formatBytes(s.rate_out)).arg(s.cpu_ms / 1000.0, 0, 'f', 1);
+			if (s.failed) {
+				line += tr(", %1 failed").arg(s.failed);
 			}
-			input.close();
-			ui->editLog->appendPlainText(tr("Closed input file %1").arg(input.fileName()));
+			lines.append(line);
 		}
-		input_offset += pos;
+		ui->lblStages->setText(lines.join('\n'));
+		ui->lblStages->show();
 	}
+}
 
-	auto written = p->write(input_buffer.data(), input_offset);
-	if (written == 0) {
+// Runs a job without any widgets, logging to stderr and reporting progress as tab-separated lines on stdout
+static int runHeadless(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+
+	app.setOrganizationDomain("grammarsoft.com");
+	app.setOrganizationName("GrammarSoft ApS");
+	app.setApplicationName("CG-3 IDE Processor");
+	Trace::fromEnvironment("CG3PROCESSOR_TRACE");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Runs CG-3 over a batch of input files without a GUI.");
+	auto help = parser.addHelpOption();
+	parser.addOption(QCommandLineOption("headless", "Run without a GUI. Logs go to stderr, progress lines to stdout."));
+	parser.addOption(QCommandLineOption("binary", "The vislcg3 binary to run.", "path"));
+	parser.addOption(QCommandLineOption("grammar", "The grammar to apply.", "file"));
+	parser.addOption(QCommandLineOption("input", "An input file. May be given several times.", "file"));
+	parser.addOption(QCommandLineOption("pipe", "A program the input is sent through before CG-3. May be given several times to chain programs.", "command"));
+	parser.addOption(QCommandLineOption("output", "The output file. Names ending in .gz or .zst are compressed.", "file"));
+	parser.addOption(QCommandLineOption("split", "Write one output file per input file."));
+	parser.addOption(QCommandLineOption("workers", "Number of CG-3 processes to run in parallel.", "n"));
+	parser.addOption(QCommandLineOption("chunk-size", "Cut big input files into chunks of about this many bytes.", "bytes"));
+	parser.addOption(QCommandLineOption("journal", "Record finished work in this file, so an interrupted run can be resumed. Params files turn this on with journal 1, which uses the params file name plus .journal, or with journal_file.", "file"));
+	parser.addOption(QCommandLineOption("resume", "Skip work the journal says is finished, and append to partially written output."));
+	parser.addOption(QCommandLineOption("fsync", "When to force output to disk: none, close (each file as it's closed) or chunk (also before journaling each chunk).", "policy"));
+	parser.addOption(QCommandLineOption("memory-limit", "Kill CG-3 if its RSS goes over this many MiB.", "MiB"));
+	parser.addOption(QCommandLineOption("cpu-limit", "Kill CG-3 if it uses more than this many seconds of CPU time.", "seconds"));
+	parser.addOption(QCommandLineOption("log-file", "Also append every log line to this file.", "file"));
+	parser.addOption(QCommandLineOption("stats", "Write throughput and resource stats as JSON to this file when done.", "file"));
+	parser.addPositionalArgument("params", "Params file as written by CG-3 IDE. Options given on the command line override it.", "[params]");
+
+	if (!parser.parse(app.arguments())) {
+		fprintf(stderr, "%s\n", qUtf8Printable(parser.errorText()));
+		return ProcessorJob::EXIT_USAGE;
 	}
-	else if (written == -1) {
-		ui->editLog->appendPlainText(tr("Failed to write data to pipe / process"));
+	if (parser.isSet(help)) {
+		fprintf(stdout, "%s", qUtf8Printable(parser.helpText()));
+		return ProcessorJob::EXIT_OK;
 	}
-	else if (written == input_offset) {
-		input_offset = 0;
+
+	ProcessorJob job;
+	QObject::connect(&job, &ProcessorJob::log, [](const QString& line) {
+		fprintf(stderr, "%s\n", qUtf8Printable(line));
+	});
+	QObject::connect(&job, &ProcessorJob::logCG, [](const QString& line) {
+		fprintf(stderr, "cg3: %s\n", qUtf8Printable(line));
+	});
+	QObject::connect(&job, &ProcessorJob::logPipe, [](const QString& line) {
+		fprintf(stderr, "pipe: %s\n", qUtf8Printable(line));
+	});
+	QObject::connect(&job, &ProcessorJob::progress, [](int done, int total) {
+		fprintf(stdout, "progress\t%d\t%d\n", done, total);
+		fflush(stdout);
+	});
+	QObject::connect(&job, &ProcessorJob::statsUpdated, [&job]() {
+		auto& st = job.stats();
+		fprintf(stdout, "stats\t%lld\t%lld\t%lld\t%lld\t%.0f\t%.0f\t%.0f\t%lld\t%lld\t%lld\n",
+			static_cast<long long>(st.bytes_in), static_cast<long long>(st.bytes_total), static_cast<long long>(st.bytes_out), static_cast<long long>(st.cohorts),
+			st.rate_in, st.rate_out, st.rate_cohorts,
+			static_cast<long long>(st.eta_ms), static_cast<long long>(st.cpu_ms), static_cast<long long>(st.peak_rss_kb));
+		fflush(stdout);
+	});
+	QObject::connect(&job, &ProcessorJob::done, [](int code) {
+		fprintf(stdout, "done\t%d\n", code);
+		fflush(stdout);
+		QCoreApplication::exit(code);
+	});
+
+	auto pos = parser.positionalArguments();
+	if (!pos.isEmpty() && !job.loadParams(pos.first())) {
+		fprintf(stderr, "Could not read %s\n", qUtf8Printable(pos.first()));
+		return ProcessorJob::EXIT_USAGE;
 	}
-	else {
-		input_buffer = input_buffer.mid(written, input_offset-written);
-		input_buffer.resize(32768);
+	if (parser.isSet("binary")) {
+		job.setBinary(parser.value("binary"));
 	}
-
-	if (!input.isOpen() && !inputs.empty()) {
-		auto file = inputs.front().filePath();
-		input.setFileName(file);
-		if (!input.open(QIODevice::ReadOnly)) {
-			ui->editLog->appendPlainText(tr("Failed to open input file %1").arg(file));
-			return;
+	if (parser.isSet("grammar")) {
+		job.setGrammar(parser.value("grammar"));
+	}
+	for (auto& input : parser.values("input")) {
+		if (!job.addInputFile(input)) {
+			fprintf(stderr, "Could not read input file %s\n", qUtf8Printable(input));
+			return ProcessorJob::EXIT_IO;
 		}
-		ui->editLog->appendPlainText(tr("Opened input file %1").arg(file));
-		outputs.append(inputs.front());
-		inputs.pop_front();
 	}
-
-	if (input.isOpen()) {
-		timer->start(100);
+	for (auto& pipe : parser.values("pipe")) {
+		job.addPipe(pipe);
 	}
-	else {
-		p->closeWriteChannel();
+	if (parser.isSet("output")) {
+		job.setOutputFile(parser.value("output"));
 	}
-}
-
-void Processor::process_started() {
-	ui->editLogCG->appendPlainText(tr("Launched CG-3"));
-}
-
-void Processor::process_error(QProcess::ProcessError error) {
-	ui->editLogCG->appendPlainText(tr("CG-3 reported error %1").arg(error));
-}
-
-void Processor::process_finished(int code, QProcess::ExitStatus status) {
-	ui->editLogCG->appendPlainText(tr("CG-3 exited with code %1 and status %2").arg(code).arg(status));
-
-	process_readyReadStandardOutput();
-	output.close();
-	ui->editLog->appendPlainText(tr("Closed output file %1").arg(output.fileName()));
-
-	if (code == 0 && status == QProcess::NormalExit) {
-		ui->editLogCG->appendPlainText("\n" + tr("All done!"));
-		ui->editLog->appendPlainText("\n" + tr("All done!"));
+	if (parser.isSet("split")) {
+		job.setOutputSplit(true);
 	}
-}
-
-void Processor::process_readyReadStandardOutput() {
-	if (!output.isOpen() && !outputs.isEmpty()) {
-		auto file = output_name;
-		if (split) {
-			file = QFileInfo(output_name).path() + outputs.front().fileName() + QFileInfo(output_name).fileName();
-		}
-		output.setFileName(file);
-		if (!output.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
-			ui->editLog->appendPlainText(tr("Failed to open output file %1").arg(file));
-			on_btnAbortForce_clicked(true);
-			return;
-		}
-		ui->editLog->appendPlainText(tr("Opened output file %1").arg(file));
-		outputs.pop_front();
+	if (parser.isSet("workers")) {
+		job.setWorkers(parser.value("workers").toInt());
 	}
-
-	process->setReadChannel(QProcess::StandardOutput);
-	QString line;
-	while (!(line = process->readLine(32768)).isEmpty()) {
-		output.write(line.toUtf8());
-		if (split && line.at(0) == '<' && line == "<STREAMCMD:FLUSH>\n") {
-			output.close();
-			ui->editLog->appendPlainText(tr("Closed output file %1").arg(output.fileName()));
-		}
+	if (parser.isSet("chunk-size")) {
+		job.setChunkSize(parser.value("chunk-size").toLongLong());
 	}
-}
-
-void Processor::process_readyReadStandardError() {
-	process->setReadChannel(QProcess::StandardError);
-	QString line;
-	while (!(line = process->readLine(32768)).isEmpty()) {
-		ui->editLogCG->appendPlainText(line.trimmed());
+	if (parser.isSet("stats")) {
+		job.setStatsFile(parser.value("stats"));
 	}
-}
-
-void Processor::pipe_started() {
-	ui->editLogPipe->appendPlainText(tr("Launched pipe"));
-}
+	if (parser.isSet("fsync")) {
+		job.setFsync(parser.value("fsync"));
+	}
+	if (parser.isSet("memory-limit") || parser.isSet("cpu-limit")) {
+		ProcessLimits limits;
+		limits.memory_kb = parser.value("memory-limit").toLongLong() * 1024;
+		limits.cpu_ms = parser.value("cpu-limit").toLongLong() * 1000;
+		job.setLimits(limits);
+	}
+	if (parser.isSet("log-file")) {
+		job.setLogFile(parser.value("log-file"));
+	}
+	if (parser.isSet("journal")) {
+		job.setJournalFile(parser.value("journal"));
+	}
+	job.setResume(parser.isSet("resume"));
 
-void Processor::pipe_error(QProcess::ProcessError error) {
-	ui->editLogPipe->appendPlainText(tr("Pipe reported error %1").arg(error));
-}
+	QTimer::singleShot(0, &job, SLOT(start()));
 
-void Processor::pipe_finished(int code, QProcess::ExitStatus status) {
-	ui->editLogPipe->appendPlainText(tr("Pipe exited with code %1 and status %2").arg(code).arg(status));
+	return app.exec();
 }
 
-void Processor::pipe_readyReadStandardError() {
-	pipe->setReadChannel(QProcess::StandardError);
-	QString line;
-	while (!(line = pipe->readLine(32768)).isEmpty()) {
-		ui->editLogPipe->appendPlainText(line.trimmed());
-	}
-}
+// Hands a params file to the running queue, starting one if needed, and prints the job ID
+static int runSubmit(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
 
-void Processor::on_btnAbort_clicked(bool) {
-	if (pipe) {
-		ui->editLog->appendPlainText(tr("Sending friendly terminate signal to pipe..."));
-		pipe->terminate();
+	auto args = app.arguments();
+	args.pop_front();
+	args.removeAll("--submit");
+	int priority = 0;
+	auto pi = args.indexOf("--priority");
+	if (pi != -1 && pi + 1 < args.size()) {
+		priority = args.at(pi + 1).toInt();
+		args.erase(args.begin() + pi, args.begin() + pi + 2);
 	}
-	if (process) {
-		ui->editLog->appendPlainText(tr("Sending friendly terminate signal to CG-3..."));
-		process->terminate();
+	if (args.empty()) {
+		fprintf(stderr, "Usage: cg3processor --submit <params> [--priority N]\n");
+		return ProcessorJob::EXIT_USAGE;
 	}
-}
 
-void Processor::on_btnAbortForce_clicked(bool) {
-	on_btnAbort_clicked(true);
-	if (pipe) {
-		ui->editLog->appendPlainText(tr("Sending kill signal to pipe..."));
-		pipe->kill();
-	}
-	if (process) {
-		ui->editLog->appendPlainText(tr("Sending kill signal to CG-3..."));
-		process->kill();
-	}
-}
+	auto client = new QueueClient(QFileInfo(args.first()).absoluteFilePath(), priority);
+	QObject::connect(client, &QueueClient::queued, [](int id) {
+		fprintf(stdout, "queued\t%d\n", id);
+		QCoreApplication::exit(ProcessorJob::EXIT_OK);
+	});
+	QObject::connect(client, &QueueClient::refused, [](const QString& error) {
+		fprintf(stderr, "%s\n", qUtf8Printable(error));
+		QCoreApplication::exit(ProcessorJob::EXIT_USAGE);
+	});
+	QObject::connect(client, &QueueClient::unreachable, [](const QString&) {
+		fprintf(stderr, "Could not reach or start the job queue\n");
+		QCoreApplication::exit(ProcessorJob::EXIT_IO);
+	});
+	QObject::connect(client, &QueueClient::lost, [](const QString&) {
+		fprintf(stderr, "The job queue did not answer, so the job may or may not be queued\n");
+		QCoreApplication::exit(ProcessorJob::EXIT_IO);
+	});
+	QTimer::singleShot(0, client, [client]() { client->start(); });
 
-void Processor::on_btnClose_clicked(bool) {
-	on_btnAbortForce_clicked(true);
-	close();
+	return app.exec();
 }
 
 int main(int argc, char *argv[]) {
+	// Must be decided before any application object exists, as a QApplication needs a display
+	for (int i=1 ; i<argc ; ++i) {
+		if (strcmp(argv[i], "--headless") == 0) {
+			return runHeadless(argc, argv);
+		}
+		if (strcmp(argv[i], "--submit") == 0) {
+			return runSubmit(argc, argv);
+		}
+	}
+
 	QApplication app(argc, argv);
 
 	app.setOrganizationDomain("grammarsoft.com");
@@ -333,16 +327,29 @@ int main(int argc, char *argv[]) {
 	app.setQuitOnLastWindowClosed(true);
 
 	QSettings::setDefaultFormat(QSettings::IniFormat);
+	Trace::fromEnvironment("CG3PROCESSOR_TRACE");
 
 	auto args = app.arguments();
 	args.pop_front();
+	bool resume = (args.removeAll("--resume") != 0);
+
+	if (args.removeAll("--queue")) {
+		ProcessorQueue queue;
+		if (!queue.listen()) {
+			// Another queue already serves this user, and submitters will find that one
+			return 0;
+		}
+		QueueMonitor monitor(queue);
+		monitor.show();
+		return app.exec();
+	}
 
 	if (args.empty()) {
 		QMessageBox::critical(nullptr, "Missing params file!", "The first and only argument to this program must be a file with parameters!");
 		return -1;
 	}
 
-	auto w = new Processor(args.first());
+	auto w = new Processor(args.first(), resume);
 	w->show();
 
 	QTimer::singleShot(250, w, SLOT(doIt()));
@@ -22,6 +22,7 @@
 #ifndef PROCESSOR_HPP
 #define PROCESSOR_HPP
 
+#include "ProcessorJob.hpp"
 #include <QtWidgets>
 
 namespace Ui {
@@ -32,16 +33,9 @@ class Processor : public QWidget {
 	Q_OBJECT
 
 public:
-	explicit Processor(const QString&);
+	Processor(const QString&, bool);
 	~Processor();
 
-	bool addInputFile(const QString&);
-	void setBinary(const QString&);
-	void setGrammar(const QString&);
-	void setPipe(const QString&);
-	void setOutputFile(const QString&);
-	void setOutputSplit(bool);
-
 public slots:
 	void doIt();
 
@@ -49,34 +43,14 @@ protected:
 	void closeEvent(QCloseEvent *event);
 
 private slots:
-	void timer_timeout();
-	void process_started();
-	void process_error(QProcess::ProcessError);
-	void process_finished(int, QProcess::ExitStatus);
-	void process_readyReadStandardOutput();
-	void process_readyReadStandardError();
-	void pipe_started();
-	void pipe_error(QProcess::ProcessError);
-	void pipe_finished(int, QProcess::ExitStatus);
-	void pipe_readyReadStandardError();
-
 	void on_btnAbort_clicked(bool);
 	void on_btnAbortForce_clicked(bool);
 	void on_btnClose_clicked(bool);
+	void job_statsUpdated();
 
 private:
 	QScopedPointer<Ui::Processor> ui;
-	QFileInfoList inputs, outputs;
-	QFile input, output;
-	QByteArray input_buffer;
-	qint64 input_size, input_offset;
-	QStringList args;
-	QString binary;
-	QString pipes;
-	QString output_name;
-	QScopedPointer<QProcess> process, pipe;
-	QScopedPointer<QTimer> timer;
-	bool split;
+	ProcessorJob job;
 };
 
 #endif // PROCESSOR_HPP
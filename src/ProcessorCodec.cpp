@@ -0,0 +1,264 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProcessorCodec.hpp"
+#include <algorithm>
+#if defined(HAVE_ZLIB)
+	#include <zlib.h>
+#endif
+#if defined(HAVE_ZSTD)
+	#include <zstd.h>
+#endif
+
+constexpr qint64 CODEC_BLOCK = 1 << 17;
+// How far the decoder may run ahead of its reader before it has to wait
+constexpr qint64 CODEC_QUEUE_BYTES = 1 << 23;
+
+Codec detectCodec(const QString& path) {
+	// Opening a FIFO blocks until there's a writer, and peeking one loses what was read, so those go by name only
+	if (!QFileInfo(path).isFile()) {
+		return codecForName(path);
+	}
+	QFile file(path);
+	if (file.open(QIODevice::ReadOnly)) {
+		auto magic = file.peek(4);
+		if (magic.startsWith("\x1f\x8b")) {
+			return CODEC_GZIP;
+		}
+		if (magic == QByteArray("\x28\xb5\x2f\xfd", 4)) {
+			return CODEC_ZSTD;
+		}
+		return CODEC_NONE;
+	}
+	return codecForName(path);
+}
+
+Codec codecForName(const QString& path) {
+	if (path.endsWith(".gz", Qt::CaseInsensitive)) {
+		return CODEC_GZIP;
+	}
+	if (path.endsWith(".zst", Qt::CaseInsensitive)) {
+		return CODEC_ZSTD;
+	}
+	return CODEC_NONE;
+}
+
+const char *codecName(Codec codec) {
+	switch (codec) {
+	case CODEC_GZIP:
+		return "gzip";
+	case CODEC_ZSTD:
+		return "zstd";
+	default:
+		return "none";
+	}
+}
+
+ProcessorDecoder::ProcessorDecoder(QObject *parent, const QString& path, Codec codec) :
+	QThread(parent),
+	path(path),
+	codec(codec),
+	current_pos(0),
+	queued(0),
+	done(false),
+	cancel(false),
+	in_bytes(0)
+{
+}
+
+ProcessorDecoder::~ProcessorDecoder() {
+	{
+		QMutexLocker lock(&mutex);
+		cancel = true;
+		not_full.wakeAll();
+	}
+	wait();
+}
+
+// Copies out up to max decompressed bytes. Returns 0 if none are ready yet, and -1 once everything has been read or on error.
+qint64 ProcessorDecoder::read(char *data, qint64 max) {
+	QMutexLocker lock(&mutex);
+	qint64 n = 0;
+	while (n < max) {
+		if (current_pos == current.size()) {
+			if (blocks.isEmpty()) {
+				break;
+			}
+			current = blocks.dequeue();
+			current_pos = 0;
+			queued -= current.size();
+			not_full.wakeOne();
+		}
+		auto c = std::min(max - n, static_cast<qint64>(current.size()) - current_pos);
+		memcpy(data + n, current.constData() + current_pos, c);
+		current_pos += c;
+		n += c;
+	}
+	if (n == 0 && done) {
+		return -1;
+	}
+	return n;
+}
+
+// Compressed bytes read so far
+qint64 ProcessorDecoder::consumed() const {
+	return in_bytes.loadRelaxed();
+}
+
+QString ProcessorDecoder::errorString() {
+	QMutexLocker lock(&mutex);
+	return error;
+}
+
+bool ProcessorDecoder::push(const char *data, qint64 n) {
+	QMutexLocker lock(&mutex);
+	while (queued >= CODEC_QUEUE_BYTES && !cancel) {
+		not_full.wait(&mutex);
+	}
+	if (cancel) {
+		return false;
+	}
+	// Only a reader that found nothing needs telling
+	bool starved = blocks.isEmpty() && current_pos == current.size();
+	blocks.enqueue(QByteArray(data, n));
+	queued += n;
+	lock.unlock();
+	if (starved) {
+		emit readyRead();
+	}
+	return true;
+}
+
+void ProcessorDecoder::fail(const QString& msg) {
+	QMutexLocker lock(&mutex);
+	error = msg;
+}
+
+void ProcessorDecoder::run() {
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		fail(file.errorString());
+	}
+	else {
+		QByteArray in(CODEC_BLOCK, 0);
+		QByteArray out(CODEC_BLOCK, 0);
+		auto input = [&]() {
+			auto n = file.read(in.data(), in.size());
+			if (n < 0) {
+				fail(file.errorString());
+			}
+			if (n > 0) {
+				in_bytes.fetchAndAddRelaxed(n);
+			}
+			return n;
+		};
+
+		if (codec == CODEC_GZIP) {
+#if defined(HAVE_ZLIB)
+			z_stream zs{};
+			// 32 lets zlib take either a gzip or a zlib header
+			if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+				fail("inflateInit2() failed");
+			}
+			else {
+				int rc = Z_OK;
+				qint64 n = 0;
+				while ((n = input()) > 0) {
+					zs.next_in = reinterpret_cast<Bytef*>(in.data());
+					zs.avail_in = static_cast<uInt>(n);
+					do {
+						// Concatenated gzip members, as from appending to a file, are one stream
+						if (rc == Z_STREAM_END) {
+							inflateReset(&zs);
+						}
+						zs.next_out = reinterpret_cast<Bytef*>(out.data());
+						zs.avail_out = static_cast<uInt>(out.size());
+						rc = inflate(&zs, Z_NO_FLUSH);
+						if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+							fail(zs.msg ? zs.msg : "inflate() failed");
+							n = -1;
+							break;
+						}
+						auto produced = out.size() - zs.avail_out;
+						if (produced && !push(out.constData(), produced)) {
+							n = -1;
+							break;
+						}
+					} while (zs.avail_in > 0 || zs.avail_out == 0);
+					if (n < 0) {
+						break;
+					}
+				}
+				if (n == 0 && rc != Z_STREAM_END) {
+					fail("Unexpected end of gzip stream");
+				}
+				inflateEnd(&zs);
+			}
+#else
+			fail("gzip support was not built in");
+#endif
+		}
+		else if (codec == CODEC_ZSTD) {
+#if defined(HAVE_ZSTD)
+			auto ds = ZSTD_createDStream();
+			size_t rc = 0;
+			qint64 n = 0;
+			while ((n = input()) > 0) {
+				ZSTD_inBuffer ib{in.constData(), static_cast<size_t>(n), 0};
+				ZSTD_outBuffer ob{out.data(), static_cast<size_t>(out.size()), 0};
+				do {
+					ob.pos = 0;
+					rc = ZSTD_decompressStream(ds, &ob, &ib);
+					if (ZSTD_isError(rc)) {
+						fail(ZSTD_getErrorName(rc));
+						n = -1;
+						break;
+					}
+					if (ob.pos && !push(out.constData(), ob.pos)) {
+						n = -1;
+						break;
+					}
+				} while (ib.pos < ib.size || ob.pos == ob.size);
+				if (n < 0) {
+					break;
+				}
+			}
+			if (n == 0 && rc != 0) {
+				fail("Unexpected end of zstd stream");
+			}
+			ZSTD_freeDStream(ds);
+#else
+			fail("zstd support was not built in");
+#endif
+		}
+		else {
+			qint64 n = 0;
+			while ((n = input()) > 0 && push(in.constData(), n)) {
+			}
+		}
+	}
+
+	{
+		QMutexLocker lock(&mutex);
+		done = true;
+	}
+	emit readyRead();
+}
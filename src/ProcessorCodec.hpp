@@ -0,0 +1,72 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef PROCESSORCODEC_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define PROCESSORCODEC_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+
+enum Codec {
+	CODEC_NONE,
+	CODEC_GZIP,
+	CODEC_ZSTD,
+};
+
+Codec detectCodec(const QString&);
+Codec codecForName(const QString&);
+const char *codecName(Codec);
+
+// Decompresses a file on its own thread into a bounded queue, which the owner drains with read() whenever readyRead() says there's more
+class ProcessorDecoder : public QThread {
+	Q_OBJECT
+
+public:
+	ProcessorDecoder(QObject *parent, const QString& path, Codec codec);
+	~ProcessorDecoder();
+
+	qint64 read(char*, qint64);
+	qint64 consumed() const;
+	QString errorString();
+
+signals:
+	void readyRead();
+
+protected:
+	void run() override;
+
+private:
+	bool push(const char*, qint64);
+	void fail(const QString&);
+
+	QString path;
+	Codec codec;
+	QMutex mutex;
+	QWaitCondition not_full;
+	QQueue<QByteArray> blocks;
+	QByteArray current;
+	qint64 current_pos, queued;
+	bool done, cancel;
+	QString error;
+	QAtomicInteger<qint64> in_bytes;
+};
+
+#endif // PROCESSORCODEC_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -0,0 +1,951 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProcessorJob.hpp"
+#include "Trace.hpp"
+#include "inlines.hpp"
+#include "version.hpp"
+#include <algorithm>
+#include <limits>
+#if defined(Q_OS_UNIX)
+	#include <sys/resource.h>
+#endif
+
+constexpr int OUTPUT_BUFFER_SIZE = 1 << 20;
+constexpr int STATS_TICK_MS = 1000;
+
+// Counts cohorts as lines starting with "<. Where the previous block left off is carried over,
+// so a line start or a "< split between two blocks is still counted exactly once.
+static qint64 countCohorts(const char *data, qint64 n, ProcessorJob::LineState& state) {
+	qint64 count = 0;
+	for (qint64 i=0 ; i<n ; ++i) {
+		auto c = data[i];
+		if (state == ProcessorJob::LINE_QUOTE && c == '<') {
+			++count;
+		}
+		if (c == '\n') {
+			state = ProcessorJob::LINE_START;
+		}
+		else if (state == ProcessorJob::LINE_START && c == '"') {
+			state = ProcessorJob::LINE_QUOTE;
+		}
+		else {
+			state = ProcessorJob::LINE_MID;
+		}
+	}
+	return count;
+}
+
+ProcessorJob::ProcessorJob(QObject *parent) :
+	QObject(parent),
+	out_seq(0),
+	writer(nullptr),
+	fsync(ProcessorWriter::FSYNC_NONE),
+	sync_ticket(0),
+	input_size(0),
+	num_workers(1),
+	running(0),
+	chunk_size(0),
+	split(false),
+	delimit(false),
+	status(EXIT_OK),
+	tick_ms(0),
+	tick_in(0),
+	tick_out(0),
+	tick_cohorts(0),
+	trace_job(0),
+	out_line(LINE_START),
+	resume(false),
+	log_failed(false),
+	log_lines(10000)
+{
+	tick_timer.setInterval(STATS_TICK_MS);
+	connect(&tick_timer, SIGNAL(timeout()), this, SLOT(tick()));
+	connect(this, SIGNAL(log(QString)), this, SLOT(tee_log(QString)));
+	connect(this, SIGNAL(logCG(QString)), this, SLOT(tee_logCG(QString)));
+	connect(this, SIGNAL(logPipe(QString)), this, SLOT(tee_logPipe(QString)));
+}
+
+ProcessorJob::~ProcessorJob() {
+}
+
+bool ProcessorJob::loadParams(const QString& paramname) {
+	QFile paramf(paramname);
+	if (!paramf.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	// Journaling needs flush markers between chunks, so it's only on when asked for, by journal or journal_file.
+	// A --resume of an unjournaled run still looks for, and then keeps, the journal next to the params file.
+	default_journal = paramname + ".journal";
+	QString journal_file;
+	auto journaled = false;
+
+	QTextStream paramt(&paramf);
+	setEncoding(paramt);
+
+	while (!paramt.atEnd()) {
+		auto tmp = paramt.readLine();
+		tmp = tmp.trimmed();
+		if (!tmp.isEmpty() && tmp.at(0) != '#' && tmp.contains('\t')) {
+			auto ls = tmp.split('\t');
+			if (ls.at(0) == "binary") {
+				setBinary(ls.at(1));
+			}
+			else if (ls.at(0) == "grammar") {
+				setGrammar(ls.at(1));
+			}
+			else if (ls.at(0) == "inputs") {
+				auto ss = ls.at(1).split("|");
+				for (auto& s : ss) {
+					addInputFile(s);
+				}
+			}
+			else if (ls.at(0) == "pipe") {
+				addPipe(ls.at(1));
+			}
+			else if (ls.at(0) == "output_file") {
+				setOutputFile(ls.at(1));
+			}
+			else if (ls.at(0) == "output_split") {
+				setOutputSplit(QVariant(ls.at(1)).toBool());
+			}
+			else if (ls.at(0) == "workers") {
+				setWorkers(ls.at(1).toInt());
+			}
+			else if (ls.at(0) == "chunk_size") {
+				setChunkSize(ls.at(1).toLongLong());
+			}
+			else if (ls.at(0) == "stats_file") {
+				setStatsFile(ls.at(1));
+			}
+			else if (ls.at(0) == "journal_file") {
+				journal_file = ls.at(1);
+				journaled = true;
+			}
+			else if (ls.at(0) == "journal") {
+				journaled = QVariant(ls.at(1)).toBool();
+			}
+			else if (ls.at(0) == "log_file") {
+				setLogFile(ls.at(1));
+			}
+			else if (ls.at(0) == "log_lines") {
+				setLogLines(ls.at(1).toInt());
+			}
+			else if (ls.at(0) == "output_fsync") {
+				setFsync(ls.at(1));
+			}
+			else if (ls.at(0) == "memory_limit_mb") {
+				limits.memory_kb = ls.at(1).toLongLong() * 1024;
+			}
+			else if (ls.at(0) == "cpu_limit_s") {
+				limits.cpu_ms = ls.at(1).toLongLong() * 1000;
+			}
+		}
+	}
+	if (journaled) {
+		setJournalFile(journal_file.isEmpty() ? default_journal : journal_file);
+	}
+
+	return true;
+}
+
+bool ProcessorJob::addInputFile(const QString& name) {
+	QFileInfo info(name);
+	// FIFOs and other non-regular files are allowed, and are streamed rather than mapped
+	if (info.exists() && info.isReadable() && !info.isDir()) {
+		inputs.append(info);
+		if (info.isFile()) {
+			input_size += info.size();
+		}
+		emit log(tr("Added file %1 as input").arg(name));
+		return true;
+	}
+	return false;
+}
+
+void ProcessorJob::setBinary(const QString& b) {
+	binary = b;
+}
+
+void ProcessorJob::setGrammar(const QString& g) {
+	grammar = g;
+	args = QStringList() << "-v" << "-g" << g;
+}
+
+// Each call adds a stage to the chain in front of CG-3
+void ProcessorJob::addPipe(const QString& p) {
+	pipes.append(p);
+}
+
+void ProcessorJob::setOutputFile(const QString& o) {
+	output_name = o;
+}
+
+void ProcessorJob::setOutputSplit(bool state) {
+	split = state;
+}
+
+void ProcessorJob::setWorkers(int n) {
+	num_workers = std::max(n, 1);
+}
+
+void ProcessorJob::setChunkSize(qint64 size) {
+	chunk_size = std::max(size, static_cast<qint64>(0));
+}
+
+void ProcessorJob::setStatsFile(const QString& s) {
+	stats_name = s;
+}
+
+void ProcessorJob::setJournalFile(const QString& j) {
+	journal_name = j;
+}
+
+void ProcessorJob::setResume(bool state) {
+	resume = state;
+}
+
+void ProcessorJob::setLogFile(const QString& l) {
+	log_name = l;
+}
+
+void ProcessorJob::setLogLines(int n) {
+	log_lines = std::max(n, 1);
+}
+
+// Applies to each CG-3 process; pipe stages are not limited
+void ProcessorJob::setLimits(const ProcessLimits& l) {
+	limits = l;
+}
+
+// none leaves flushing to the OS, close syncs each output file as it's closed, chunk also syncs before journaling each chunk
+void ProcessorJob::setFsync(const QString& policy) {
+	if (policy == "chunk") {
+		fsync = ProcessorWriter::FSYNC_CHUNK;
+	}
+	else if (policy == "close") {
+		fsync = ProcessorWriter::FSYNC_CLOSE;
+	}
+	else {
+		fsync = ProcessorWriter::FSYNC_NONE;
+	}
+}
+
+const QFileInfoList& ProcessorJob::inputFiles() const {
+	return inputs;
+}
+
+qint64 ProcessorJob::inputSize() const {
+	return input_size;
+}
+
+bool ProcessorJob::hasPipe() const {
+	return !pipes.isEmpty();
+}
+
+const QString& ProcessorJob::outputFile() const {
+	return output_name;
+}
+
+int ProcessorJob::numWorkers() const {
+	return num_workers;
+}
+
+const ProcessorStats& ProcessorJob::stats() const {
+	return st;
+}
+
+int ProcessorJob::logLines() const {
+	return log_lines;
+}
+
+void ProcessorJob::start() {
+	trace_job = Trace::now();
+	if (output_name.isEmpty()) {
+		emit log(tr("No output file given"));
+		emit done(EXIT_USAGE);
+		return;
+	}
+
+	if (resume && journal_name.isEmpty()) {
+		journal_name = default_journal;
+	}
+	if (resume && journal_name.isEmpty()) {
+		emit log(tr("No journal to resume from"));
+		emit done(EXIT_USAGE);
+		return;
+	}
+	if (!journal_name.isEmpty()) {
+		openJournal(resume && loadJournal());
+	}
+
+	// Output of concurrent workers, of split files, and of journaled chunks must be told apart, which needs flush markers between chunks
+	delimit = (split || num_workers > 1 || journal.isOpen());
+	planChunks(delimit);
+	output_buffer.reserve(OUTPUT_BUFFER_SIZE);
+
+	writer = new ProcessorWriter(this, fsync);
+	connect(writer, SIGNAL(opened(QString,qint64)), this, SLOT(writer_opened(QString,qint64)));
+	connect(writer, SIGNAL(synced(int,qint64)), this, SLOT(writer_synced(int,qint64)));
+	connect(writer, SIGNAL(closed(QString)), this, SLOT(writer_closed(QString)));
+	connect(writer, SIGNAL(failed(QString)), this, SLOT(writer_failed(QString)));
+	connect(writer, SIGNAL(finished()), this, SLOT(writer_finished()));
+	writer->start();
+
+	st = ProcessorStats();
+	for (auto& p : pipes) {
+		st.stages.append(StageStats());
+		st.stages.back().command = p;
+	}
+	st.stages.append(StageStats());
+	st.stages.back().command = binary;
+	for (auto& c : plan) {
+		st.bytes_total += (c.length < 0 && inputs[c.file].isFile()) ? inputs[c.file].size() : std::max(c.length, qint64(0));
+	}
+	file_in.fill(0, inputs.size());
+	file_start.fill(-1, inputs.size());
+	file_ms.fill(-1, inputs.size());
+	clock.start();
+	tick_timer.start();
+
+	int n = std::max(std::min(num_workers, static_cast<int>(plan.size())), 1);
+	if (n > 1) {
+		emit log(tr("Running %1 workers over %2 chunks").arg(n).arg(plan.size()));
+	}
+
+	for (int i=0 ; i<n ; ++i) {
+		auto w = new ProcessorWorker(this, (n > 1) ? i+1 : 0, inputs, delimit, split);
+		connect(w, SIGNAL(log(QString)), this, SIGNAL(log(QString)));
+		connect(w, SIGNAL(logCG(QString)), this, SIGNAL(logCG(QString)));
+		connect(w, SIGNAL(logPipe(QString)), this, SIGNAL(logPipe(QString)));
+		connect(w, SIGNAL(inputError(QString)), this, SLOT(worker_inputError(QString)));
+		connect(w, SIGNAL(fed(int,qint64)), this, SLOT(worker_fed(int,qint64)));
+		connect(w, SIGNAL(output(int,QByteArray,bool)), this, SLOT(worker_output(int,QByteArray,bool)));
+		connect(w, SIGNAL(finished(bool)), this, SLOT(worker_finished(bool)));
+		workers.append(w);
+		w->start(binary, args, pipes, limits);
+	}
+	running = n;
+
+	dispatch();
+}
+
+void ProcessorJob::planChunks(bool chunked) {
+	TRACE_SPAN("plan chunks");
+	plan.clear();
+	for (int f=0 ; f<inputs.size() ; ++f) {
+		auto path = inputs[f].filePath();
+		if (resume_done.contains(path)) {
+			emit log(tr("Skipping %1, which a previous run finished").arg(path));
+			continue;
+		}
+
+		qint64 size = inputs[f].isFile() ? inputs[f].size() : -1;
+		qint64 offset = resume_in.value(path, 0);
+		// Compressed files can only be read from the start, so they're streamed whole like FIFOs
+		auto codec = detectCodec(path);
+		if (codec != CODEC_NONE) {
+			size = -1;
+			offset = 0;
+		}
+		if (offset) {
+			emit log(tr("Resuming %1 from byte %2").arg(path).arg(offset));
+		}
+
+		// Big files are cut at the first blank line or <STREAMCMD:FLUSH> past each chunk_size bytes, so no window is split
+		QFile file(inputs[f].filePath());
+		if (chunked && chunk_size > 0 && size > chunk_size && file.open(QIODevice::ReadOnly)) {
+			while (size - offset > chunk_size && file.seek(offset + chunk_size)) {
+				file.readLine();
+				qint64 end = size;
+				while (!file.atEnd()) {
+					auto line = file.readLine();
+					if (line == "\n" || line == "\r\n" || line.startsWith("<STREAMCMD:FLUSH>")) {
+						end = file.pos();
+						break;
+					}
+				}
+				if (end >= size) {
+					break;
+				}
+				Chunk c;
+				c.seq = plan.size();
+				c.file = f;
+				c.offset = offset;
+				c.length = end - offset;
+				c.last = false;
+				plan.append(c);
+				offset = end;
+			}
+		}
+
+		Chunk c;
+		c.seq = plan.size();
+		c.file = f;
+		c.offset = offset;
+		c.length = (size < 0) ? -1 : size - offset;
+		c.codec = codec;
+		plan.append(c);
+	}
+
+	queue.clear();
+	for (auto& c : plan) {
+		queue.append(c);
+	}
+}
+
+void ProcessorJob::dispatch() {
+	// Undelimited output can only complete when CG-3 exits, so the single worker gets everything up front
+	int depth = delimit ? 2 : std::numeric_limits<int>::max();
+	// Don't let fast workers run too far ahead of the chunk being written, as their output is held in memory until then
+	int ahead = out_seq + static_cast<int>(workers.size())*4;
+	for (int d=1 ; d<=depth && !queue.isEmpty() ; ++d) {
+		for (auto w : workers) {
+			if (!queue.isEmpty() && (!delimit || queue.front().seq < ahead) && w->isRunning() && w->pending() < d) {
+				w->enqueue(queue.takeFirst());
+			}
+		}
+	}
+	if (queue.isEmpty()) {
+		for (auto w : workers) {
+			w->finish();
+		}
+	}
+}
+
+void ProcessorJob::writeOutput(int seq, const QByteArray& data) {
+	if (output_open.isEmpty()) {
+		output_open = outputName(plan[seq].file);
+		// A resumed output is cut back to the end of the last chunk the journal vouches for, dropping any partial chunk after it
+		writer->open(output_open, resume_out.value(output_open, -1));
+	}
+
+	st.bytes_out += data.size();
+	st.cohorts += countCohorts(data.constData(), data.size(), out_line);
+
+	if (output_buffer.isEmpty() && data.size() >= OUTPUT_BUFFER_SIZE) {
+		writeRaw(data);
+		return;
+	}
+	output_buffer.append(data);
+	if (output_buffer.size() >= OUTPUT_BUFFER_SIZE) {
+		flushOutput();
+	}
+}
+
+void ProcessorJob::writeRaw(const QByteArray& data) {
+	writer->write(data);
+}
+
+void ProcessorJob::flushOutput() {
+	if (output_buffer.isEmpty()) {
+		return;
+	}
+	writeRaw(output_buffer);
+	// The writer holds on to the block, so start a fresh one rather than detach it
+	output_buffer = QByteArray();
+	output_buffer.reserve(OUTPUT_BUFFER_SIZE);
+}
+
+void ProcessorJob::closeOutput() {
+	if (!output_open.isEmpty()) {
+		flushOutput();
+		writer->close();
+		output_open.clear();
+	}
+}
+
+void ProcessorJob::finishChunk(int seq) {
+	auto f = plan[seq].file;
+	if (plan[seq].last && file_start[f] >= 0) {
+		file_ms[f] = clock.elapsed() - file_start[f];
+		if (Trace::enabled()) {
+			Trace::record("input file", Trace::now() - file_ms[f]*1000, inputs[f].fileName());
+		}
+		emit log(tr("Finished input file %1 in %2 s").arg(inputs[f].fileName()).arg(file_ms[f] / 1000.0, 0, 'f', 1));
+	}
+	if (journal.isOpen()) {
+		journalChunk(seq);
+	}
+	if (split && plan[seq].last) {
+		closeOutput();
+	}
+}
+
+void ProcessorJob::worker_output(int seq, const QByteArray& data, bool done) {
+	// Chunks finishing out of order are held back until every chunk before them has been written
+	if (seq != out_seq) {
+		results[seq].append(data);
+		if (done) {
+			completed.insert(seq);
+		}
+		return;
+	}
+
+	if (!data.isEmpty()) {
+		writeOutput(seq, data);
+	}
+	if (!done) {
+		return;
+	}
+	finishChunk(out_seq);
+	++out_seq;
+
+	while (results.contains(out_seq) || completed.contains(out_seq)) {
+		if (results.contains(out_seq)) {
+			writeOutput(out_seq, results.take(out_seq));
+		}
+		if (!completed.remove(out_seq)) {
+			break;
+		}
+		finishChunk(out_seq);
+		++out_seq;
+	}
+
+	emit progress(out_seq, plan.size());
+	dispatch();
+}
+
+void ProcessorJob::worker_inputError(const QString&) {
+	if (status == EXIT_OK) {
+		status = EXIT_IO;
+	}
+}
+
+void ProcessorJob::worker_fed(int file, qint64 n) {
+	if (file_start[file] < 0) {
+		file_start[file] = clock.elapsed();
+	}
+	file_in[file] += n;
+	st.bytes_in += n;
+}
+
+void ProcessorJob::worker_finished(bool ok) {
+	if (!ok) {
+		fail(EXIT_FAILED);
+	}
+	if (--running > 0) {
+		return;
+	}
+
+	// The rest waits for the writer to have put everything on disk
+	closeOutput();
+	writer->stop();
+}
+
+void ProcessorJob::writer_opened(const QString& file, qint64 size) {
+	if (resume_out.contains(file)) {
+		emit log(tr("Appending to output file %1 from byte %2").arg(file).arg(size));
+	}
+	else {
+		emit log(tr("Opened output file %1").arg(file));
+	}
+	auto codec = codecForName(file);
+	if (codec != CODEC_NONE) {
+		emit log(tr("Compressing output file %1 with %2").arg(file).arg(codecName(codec)));
+	}
+}
+
+void ProcessorJob::writer_synced(int ticket, qint64 size) {
+	auto line = journal_pending.take(ticket);
+	// After a failed write, what's on disk can't vouch for anything, and --resume must redo it
+	if (status != EXIT_OK) {
+		return;
+	}
+	journal.write(QString("%1\t%2\n").arg(line).arg(size).toUtf8());
+	journal.flush();
+}
+
+void ProcessorJob::writer_closed(const QString& file) {
+	emit log(tr("Closed output file %1").arg(file));
+}
+
+void ProcessorJob::writer_failed(const QString& error) {
+	emit log(error);
+	fail(EXIT_IO);
+}
+
+void ProcessorJob::writer_finished() {
+	tick_timer.stop();
+	tick();
+	sampleUsage(true);
+	// Per-stage totals, so a slow or failing stage of a pipeline can be pointed out
+	if (!pipes.isEmpty()) {
+		for (auto& s : st.stages) {
+			emit log(tr("%1: read %2 bytes, wrote %3 bytes, %4 s CPU, %5 KiB peak RSS, %6 failed").arg(s.command).arg(s.read).arg(s.written).arg(s.cpu_ms / 1000.0, 0, 'f', 1).arg(s.rss_kb).arg(s.failed));
+		}
+	}
+
+	if (status == EXIT_OK && out_seq != plan.size()) {
+		status = EXIT_FAILED;
+	}
+	writeStats();
+	if (Trace::enabled()) {
+		Trace::record("job", trace_job, output_name);
+	}
+	if (status == EXIT_OK) {
+		emit logCG("\n" + tr("All done!"));
+		emit log("\n" + tr("All done!"));
+	}
+	else if (journal.isOpen()) {
+		emit log(tr("Finished work is recorded in %1; run again with --resume to continue from there").arg(journal.fileName()));
+	}
+	journal.close();
+	// Nothing is left to resume
+	if (status == EXIT_OK && !journal.fileName().isEmpty()) {
+		journal.remove();
+	}
+	log_file.close();
+	emit done(status);
+}
+
+void ProcessorJob::fail(int code) {
+	if (status == EXIT_OK || status == EXIT_IO) {
+		status = code;
+		kill();
+	}
+}
+
+void ProcessorJob::abort() {
+	if (status == EXIT_OK) {
+		status = EXIT_ABORTED;
+	}
+	for (auto w : workers) {
+		w->terminate();
+	}
+}
+
+void ProcessorJob::kill() {
+	if (status == EXIT_OK) {
+		status = EXIT_ABORTED;
+	}
+	for (auto w : workers) {
+		w->kill();
+	}
+}
+
+void ProcessorJob::tick() {
+	QVector<qint64> tick_read, tick_written;
+	for (auto& s : st.stages) {
+		tick_read.append(s.read);
+		tick_written.append(s.written);
+	}
+	sampleUsage(false);
+
+	st.elapsed_ms = clock.elapsed();
+	if (auto dt = st.elapsed_ms - tick_ms) {
+		st.rate_in = (st.bytes_in - tick_in) * 1000.0 / dt;
+		st.rate_out = (st.bytes_out - tick_out) * 1000.0 / dt;
+		st.rate_cohorts = (st.cohorts - tick_cohorts) * 1000.0 / dt;
+		for (int i=0 ; i<st.stages.size() ; ++i) {
+			st.stages[i].rate_in = (st.stages[i].read - tick_read[i]) * 1000.0 / dt;
+			st.stages[i].rate_out = (st.stages[i].written - tick_written[i]) * 1000.0 / dt;
+		}
+	}
+	tick_ms = st.elapsed_ms;
+	tick_in = st.bytes_in;
+	tick_out = st.bytes_out;
+	tick_cohorts = st.cohorts;
+
+	// ETAs go by the average input rate of the whole run, as the rate of a single tick jumps around too much
+	double avg = st.elapsed_ms ? st.bytes_in * 1000.0 / st.elapsed_ms : 0;
+	bool streams = std::any_of(inputs.begin(), inputs.end(), [](const QFileInfo& i) { return !i.isFile(); });
+	st.eta_ms = (avg > 0 && !streams) ? static_cast<qint64>(std::max(st.bytes_total - st.bytes_in, qint64(0)) * 1000.0 / avg) : -1;
+
+	st.file = (out_seq < plan.size()) ? plan[out_seq].file : -1;
+	st.file_elapsed_ms = 0;
+	st.file_eta_ms = -1;
+	if (st.file >= 0 && file_start[st.file] >= 0) {
+		st.file_elapsed_ms = st.elapsed_ms - file_start[st.file];
+		if (avg > 0 && inputs[st.file].isFile()) {
+			auto left = inputs[st.file].size() - resume_in.value(inputs[st.file].filePath(), 0) - file_in[st.file];
+			st.file_eta_ms = static_cast<qint64>(std::max(left, qint64(0)) * 1000.0 / avg);
+		}
+	}
+
+	emit statsUpdated();
+}
+
+// CPU time and peak RSS of the CG-3 and pipe children; once they have all been reaped, the OS' totals are used where available
+void ProcessorJob::sampleUsage(bool reaped) {
+	for (auto& s : st.stages) {
+		s.read = s.written = s.cpu_ms = 0;
+		s.failed = 0;
+	}
+	qint64 cpu = 0;
+	for (auto w : workers) {
+		auto& usage = w->sample();
+		for (int i=0 ; i<usage.size() && i<st.stages.size() ; ++i) {
+			auto& s = st.stages[i];
+			auto& u = usage[i];
+			s.read += u.read;
+			s.written += u.written;
+			s.cpu_ms += u.cpu_ms;
+			s.rss_kb = std::max(s.rss_kb, u.rss_kb);
+			s.failed += (u.crashed || u.exit_code > 0);
+			cpu += u.cpu_ms;
+			st.peak_rss_kb = std::max(st.peak_rss_kb, u.rss_kb);
+		}
+	}
+	st.cpu_ms = std::max(st.cpu_ms, cpu);
+
+#if defined(Q_OS_UNIX)
+	if (reaped) {
+		struct rusage ru{};
+		if (getrusage(RUSAGE_CHILDREN, &ru) == 0) {
+			qint64 ms = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000 + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000;
+			st.cpu_ms = std::max(st.cpu_ms, ms);
+	#if defined(Q_OS_MACOS)
+			qint64 kb = ru.ru_maxrss / 1024;
+	#else
+			qint64 kb = ru.ru_maxrss;
+	#endif
+			st.peak_rss_kb = std::max(st.peak_rss_kb, kb);
+		}
+	}
+#else
+	Q_UNUSED(reaped);
+#endif
+}
+
+void ProcessorJob::writeStats() {
+	if (stats_name.isEmpty()) {
+		return;
+	}
+
+	QJsonObject config;
+	config["binary"] = binary;
+	config["args"] = QJsonArray::fromStringList(args);
+	config["pipe"] = QJsonArray::fromStringList(pipes);
+	config["workers"] = static_cast<int>(workers.size());
+	config["chunk_size"] = chunk_size;
+	config["split"] = split;
+
+	QJsonArray files;
+	for (int f=0 ; f<inputs.size() ; ++f) {
+		QJsonObject file;
+		file["name"] = inputs[f].filePath();
+		file["bytes"] = file_in[f];
+		file["elapsed_ms"] = file_ms[f];
+		files.append(file);
+	}
+
+	double secs = st.elapsed_ms / 1000.0;
+	QJsonArray stages;
+	for (auto& s : st.stages) {
+		QJsonObject stage;
+		stage["command"] = s.command;
+		stage["read"] = s.read;
+		stage["written"] = s.written;
+		stage["cpu_ms"] = s.cpu_ms;
+		stage["peak_rss_kb"] = s.rss_kb;
+		stage["failed"] = s.failed;
+		stages.append(stage);
+	}
+
+	QJsonObject totals;
+	totals["bytes_in"] = st.bytes_in;
+	totals["bytes_out"] = st.bytes_out;
+	totals["cohorts"] = st.cohorts;
+	totals["elapsed_ms"] = st.elapsed_ms;
+	totals["bytes_in_per_s"] = secs > 0 ? st.bytes_in / secs : 0;
+	totals["bytes_out_per_s"] = secs > 0 ? st.bytes_out / secs : 0;
+	totals["cohorts_per_s"] = secs > 0 ? st.cohorts / secs : 0;
+	totals["cpu_ms"] = st.cpu_ms;
+	totals["peak_rss_kb"] = st.peak_rss_kb;
+
+	QJsonObject root;
+	root["version"] = QString("%1.%2.%3.%4").arg(CG3IDE_VERSION_MAJOR).arg(CG3IDE_VERSION_MINOR).arg(CG3IDE_VERSION_PATCH).arg(CG3IDE_REVISION);
+	root["started"] = QDateTime::currentDateTime().addMSecs(-st.elapsed_ms).toString(Qt::ISODate);
+	root["config"] = config;
+	root["inputs"] = files;
+	root["stages"] = stages;
+	root["totals"] = totals;
+	root["status"] = status;
+
+	QFile file(stats_name);
+	if (!file.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+		emit log(tr("Failed to write stats file %1").arg(stats_name));
+		return;
+	}
+	file.write(QJsonDocument(root).toJson());
+	emit log(tr("Wrote stats to %1").arg(stats_name));
+}
+
+QString ProcessorJob::outputName(int file) const {
+	if (split) {
+		return QFileInfo(output_name).path() + inputs[file].fileName() + QFileInfo(output_name).fileName();
+	}
+	return output_name;
+}
+
+// Identifies what a journal was written for, so that a changed grammar, pipe, output or input file can't be resumed into
+QByteArray ProcessorJob::journalConfig() const {
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(binary.toUtf8());
+	hash.addData(args.join('\t').toUtf8());
+	QFileInfo g(grammar);
+	hash.addData(QString("\t%1|%2").arg(g.size()).arg(g.lastModified().toMSecsSinceEpoch()).toUtf8());
+	hash.addData(pipes.join('\n').toUtf8());
+	hash.addData(output_name.toUtf8());
+	hash.addData(split ? "1" : "0");
+	for (auto& i : inputs) {
+		hash.addData(QString("\t%1|%2|%3").arg(i.filePath()).arg(i.size()).arg(i.lastModified().toMSecsSinceEpoch()).toUtf8());
+	}
+	return hash.result().toHex();
+}
+
+// Reads back which chunks a previous run finished. Only chunks whose recorded output size is still on disk are trusted, as
+// output may not have been synced before a crash, and the journal is rewritten with just those before this run appends to it.
+bool ProcessorJob::loadJournal() {
+	struct Entry {
+		QString input;
+		qint64 end;
+		bool last;
+		QString output;
+		qint64 size;
+	};
+
+	QFile jf(journal_name);
+	if (!jf.open(QIODevice::ReadOnly)) {
+		emit log(tr("No journal %1 to resume from, starting over").arg(journal_name));
+		return false;
+	}
+
+	QVector<Entry> entries;
+	bool matches = false;
+	while (!jf.atEnd()) {
+		auto ls = QString::fromUtf8(jf.readLine()).trimmed().split('\t');
+		if (ls.at(0) == "config") {
+			matches = (ls.size() == 2 && ls.at(1).toUtf8() == journalConfig());
+		}
+		else if (ls.at(0) == "chunk" && ls.size() == 6) {
+			entries.append(Entry{ls.at(1), ls.at(2).toLongLong(), ls.at(3) == "1", ls.at(4), ls.at(5).toLongLong()});
+		}
+	}
+	if (!matches) {
+		emit log(tr("Journal %1 is for different settings or inputs, starting over").arg(journal_name));
+		return false;
+	}
+
+	auto onDisk = [](const QString& file) {
+		QFileInfo info(file);
+		return info.exists() ? info.size() : 0;
+	};
+
+	// Chunks are journaled in output order, so the last entry that is fully on disk vouches for everything before it in the same output
+	QHash<QString,int> trusted;
+	for (int i=0 ; i<entries.size() ; ++i) {
+		auto& e = entries[i];
+		if (e.size <= onDisk(e.output)) {
+			trusted[split ? e.input : e.output] = i;
+		}
+	}
+
+	QVector<Entry> kept;
+	for (int i=0 ; i<entries.size() ; ++i) {
+		if (i <= trusted.value(split ? entries[i].input : entries[i].output, -1)) {
+			kept.append(entries[i]);
+		}
+	}
+
+	if (!jf.remove()) {
+		emit log(tr("Could not rewrite journal %1, starting over").arg(journal_name));
+		return false;
+	}
+	openJournal(false);
+	for (auto& e : kept) {
+		resume_in[e.input] = e.end;
+		resume_out[e.output] = e.size;
+		if (e.last) {
+			resume_done.insert(e.input);
+			// Outputs of finished split inputs are complete and never reopened
+			if (split) {
+				resume_out.remove(e.output);
+			}
+		}
+		journal.write(QString("chunk\t%1\t%2\t%3\t%4\t%5\n").arg(e.input).arg(e.end).arg(e.last ? 1 : 0).arg(e.output).arg(e.size).toUtf8());
+	}
+	journal.flush();
+
+	emit log(tr("Resuming from journal %1 with %2 finished chunks").arg(journal_name).arg(kept.size()));
+	return true;
+}
+
+void ProcessorJob::openJournal(bool resumed) {
+	if (journal.isOpen()) {
+		return;
+	}
+	journal.setFileName(journal_name);
+	if (resumed) {
+		journal.open(QIODevice::WriteOnly|QIODevice::Append);
+	}
+	else if (journal.open(QIODevice::WriteOnly|QIODevice::Truncate)) {
+		journal.write("# cg3processor run journal, read by --resume\n");
+		journal.write("config\t" + journalConfig() + "\n");
+		journal.flush();
+	}
+	if (!journal.isOpen()) {
+		emit log(tr("Could not open journal %1, this run can't be resumed").arg(journal_name));
+	}
+}
+
+// Records that a chunk's output is fully written, along with where it ends in the input and in the output file.
+// The line is only written once the writer has the chunk on disk and knows the file's size.
+void ProcessorJob::journalChunk(int seq) {
+	auto& c = plan[seq];
+	flushOutput();
+	auto file = outputName(c.file);
+	qint64 end = (c.length < 0) ? -1 : c.offset + c.length;
+	auto line = QString("chunk\t%1\t%2\t%3\t%4").arg(inputs[c.file].filePath()).arg(end).arg(c.last ? 1 : 0).arg(file);
+	journal_pending.insert(++sync_ticket, line);
+	writer->sync(sync_ticket);
+}
+
+void ProcessorJob::tee_log(const QString& line) {
+	tee("", line);
+}
+
+void ProcessorJob::tee_logCG(const QString& line) {
+	tee("cg3: ", line);
+}
+
+void ProcessorJob::tee_logPipe(const QString& line) {
+	tee("pipe: ", line);
+}
+
+// Every log line in full, as the views only keep a bounded and coalesced tail
+void ProcessorJob::tee(const char *prefix, const QString& line) {
+	if (log_name.isEmpty() || log_failed) {
+		return;
+	}
+	if (!log_file.isOpen()) {
+		log_file.setFileName(log_name);
+		if (!log_file.open(QIODevice::WriteOnly|QIODevice::Append)) {
+			log_failed = true;
+			emit log(tr("Failed to open log file %1").arg(log_name));
+			return;
+		}
+	}
+	log_file.write(prefix);
+	log_file.write(line.toUtf8());
+	log_file.write("\n");
+}
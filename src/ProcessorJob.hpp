@@ -0,0 +1,202 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef PROCESSORJOB_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define PROCESSORJOB_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include "ProcessorWorker.hpp"
+#include "ProcessorWriter.hpp"
+#include <QtCore>
+
+// Summed over all workers, for one pipe stage or CG-3 itself
+struct StageStats {
+	QString command;
+	qint64 read = 0;
+	qint64 written = 0;
+	double rate_in = 0;
+	double rate_out = 0;
+	qint64 cpu_ms = 0;
+	qint64 rss_kb = 0;
+	int failed = 0;
+};
+
+// Live and final numbers of a run. Rates are per second over the last tick, -1 means unknown.
+struct ProcessorStats {
+	qint64 bytes_total = 0;
+	qint64 bytes_in = 0;
+	qint64 bytes_out = 0;
+	qint64 cohorts = 0;
+	qint64 elapsed_ms = 0;
+	double rate_in = 0;
+	double rate_out = 0;
+	double rate_cohorts = 0;
+	qint64 eta_ms = -1;
+	qint64 cpu_ms = 0;
+	qint64 peak_rss_kb = 0;
+	int file = -1;
+	qint64 file_elapsed_ms = 0;
+	qint64 file_eta_ms = -1;
+	QVector<StageStats> stages;
+};
+
+// Everything a Processor run does, without any GUI, so it can be driven by the window or headless
+class ProcessorJob : public QObject {
+	Q_OBJECT
+
+public:
+	enum {
+		EXIT_OK = 0,
+		EXIT_FAILED = 1,
+		EXIT_USAGE = 2,
+		EXIT_IO = 3,
+		EXIT_ABORTED = 4,
+	};
+
+	// Where the output so far ends, so cohort lines can be counted across blocks
+	enum LineState {
+		LINE_MID,
+		LINE_START,
+		LINE_QUOTE,
+	};
+
+	explicit ProcessorJob(QObject *parent = nullptr);
+	~ProcessorJob();
+
+	bool loadParams(const QString&);
+	bool addInputFile(const QString&);
+	void setBinary(const QString&);
+	void setGrammar(const QString&);
+	void addPipe(const QString&);
+	void setOutputFile(const QString&);
+	void setOutputSplit(bool);
+	void setWorkers(int);
+	void setChunkSize(qint64);
+	void setStatsFile(const QString&);
+	void setJournalFile(const QString&);
+	void setResume(bool);
+	void setLogFile(const QString&);
+	void setLogLines(int);
+	void setFsync(const QString&);
+	void setLimits(const ProcessLimits&);
+
+	const QFileInfoList& inputFiles() const;
+	qint64 inputSize() const;
+	bool hasPipe() const;
+	const QString& outputFile() const;
+	int numWorkers() const;
+	const ProcessorStats& stats() const;
+	int logLines() const;
+
+public slots:
+	void start();
+	void abort();
+	void kill();
+
+signals:
+	void log(const QString&);
+	void logCG(const QString&);
+	void logPipe(const QString&);
+	void progress(int, int);
+	void statsUpdated();
+	void done(int);
+
+private slots:
+	void worker_output(int, const QByteArray&, bool);
+	void worker_inputError(const QString&);
+	void worker_fed(int, qint64);
+	void worker_finished(bool);
+	void writer_opened(const QString&, qint64);
+	void writer_synced(int, qint64);
+	void writer_closed(const QString&);
+	void writer_failed(const QString&);
+	void writer_finished();
+	void tick();
+	void tee_log(const QString&);
+	void tee_logCG(const QString&);
+	void tee_logPipe(const QString&);
+
+private:
+	void planChunks(bool);
+	void dispatch();
+	void writeOutput(int, const QByteArray&);
+	void writeRaw(const QByteArray&);
+	void flushOutput();
+	void closeOutput();
+	void finishChunk(int);
+	void fail(int);
+	void sampleUsage(bool);
+	void writeStats();
+	QString outputName(int) const;
+	QByteArray journalConfig() const;
+	bool loadJournal();
+	void openJournal(bool);
+	void journalChunk(int);
+	void tee(const char*, const QString&);
+
+	QFileInfoList inputs;
+	QVector<Chunk> plan;
+	QList<Chunk> queue;
+	QMap<int,QByteArray> results;
+	QSet<int> completed;
+	int out_seq;
+	ProcessorWriter *writer;
+	ProcessorWriter::Fsync fsync;
+	QString output_open;
+	int sync_ticket;
+	QMap<int,QString> journal_pending;
+	QByteArray output_buffer;
+	qint64 input_size;
+	QStringList args;
+	QString grammar;
+	QString binary;
+	QStringList pipes;
+	QString output_name;
+	QList<ProcessorWorker*> workers;
+	ProcessLimits limits;
+	int num_workers, running;
+	qint64 chunk_size;
+	bool split, delimit;
+	int status;
+
+	QString stats_name;
+	ProcessorStats st;
+	QTimer tick_timer;
+	QElapsedTimer clock;
+	qint64 tick_ms, tick_in, tick_out, tick_cohorts;
+	qint64 trace_job;
+	QVector<qint64> file_in, file_start, file_ms;
+	LineState out_line;
+
+	QString journal_name;
+	QString default_journal;
+	QFile journal;
+	bool resume;
+	QHash<QString,qint64> resume_in, resume_out;
+	QSet<QString> resume_done;
+
+	QString log_name;
+	QFile log_file;
+	bool log_failed;
+	int log_lines;
+};
+
+#endif // PROCESSORJOB_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
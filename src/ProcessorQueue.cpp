@@ -0,0 +1,314 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProcessorQueue.hpp"
+#include "inlines.hpp"
+#include <algorithm>
+#if defined(Q_OS_UNIX)
+	#include <sys/socket.h>
+	#include <sys/types.h>
+	#include <unistd.h>
+#endif
+
+// How many finished or cancelled jobs stay listed in the queue window
+constexpr int MAX_FINISHED = 50;
+
+// The socket is only open to its owner, but a params file names programs to run, so it must belong to the owner too.
+// Otherwise anyone able to leave a params file where the owner can read it could have the queue run it.
+static bool ownsParams(QLocalSocket *sock, const QString& params) {
+	QFileInfo info(params);
+	if (!info.isFile()) {
+		return false;
+	}
+#if defined(Q_OS_UNIX)
+	auto fd = static_cast<int>(sock->socketDescriptor());
+	#if defined(Q_OS_LINUX)
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != getuid()) {
+		return false;
+	}
+	#else
+	uid_t uid = 0;
+	gid_t gid = 0;
+	if (getpeereid(fd, &uid, &gid) != 0 || uid != getuid()) {
+		return false;
+	}
+	#endif
+	return info.ownerId() == getuid();
+#else
+	Q_UNUSED(sock);
+	return true;
+#endif
+}
+
+ProcessorQueue::ProcessorQueue(QObject *parent) :
+	QObject(parent),
+	next_id(1),
+	max_workers(1)
+{
+	QSettings settings;
+	setBudget(settings.value("queue/workers", QThread::idealThreadCount()).toInt());
+	connect(&server, SIGNAL(newConnection()), this, SLOT(server_newConnection()));
+}
+
+ProcessorQueue::~ProcessorQueue() {
+}
+
+// Fails if another queue is already serving this user
+bool ProcessorQueue::listen() {
+	return listenLocal(server, queueServerName());
+}
+
+int ProcessorQueue::submit(const QString& params, int priority, QString& error) {
+	auto job = new ProcessorJob(this);
+	if (!job->loadParams(params)) {
+		delete job;
+		error = tr("Could not read %1").arg(params);
+		return -1;
+	}
+	if (job->outputFile().isEmpty()) {
+		delete job;
+		error = tr("No output file given in %1").arg(params);
+		return -1;
+	}
+
+	connect(job, SIGNAL(log(QString)), this, SLOT(job_log(QString)));
+	connect(job, SIGNAL(done(int)), this, SLOT(job_done(int)));
+	connect(job, SIGNAL(statsUpdated()), this, SIGNAL(changed()));
+
+	QueueEntry e;
+	e.id = next_id++;
+	e.params = params;
+	e.priority = priority;
+	e.workers = job->numWorkers();
+	e.submitted = QDateTime::currentDateTime();
+	e.job = job;
+	queue.append(e);
+
+	schedule();
+	emit changed();
+	return e.id;
+}
+
+void ProcessorQueue::setBudget(int n) {
+	max_workers = std::max(n, 1);
+	schedule();
+	emit changed();
+}
+
+int ProcessorQueue::budget() const {
+	return max_workers;
+}
+
+int ProcessorQueue::used() const {
+	int n = 0;
+	for (auto& e : queue) {
+		if (e.state == QueueEntry::RUNNING) {
+			n += e.workers;
+		}
+	}
+	return n;
+}
+
+bool ProcessorQueue::busy() const {
+	return std::any_of(queue.begin(), queue.end(), [](const QueueEntry& e) { return e.state == QueueEntry::QUEUED || e.state == QueueEntry::RUNNING; });
+}
+
+const QList<QueueEntry>& ProcessorQueue::entries() const {
+	return queue;
+}
+
+void ProcessorQueue::setPriority(int id, int priority) {
+	if (auto e = find(id)) {
+		e->priority = priority;
+		schedule();
+		emit changed();
+	}
+}
+
+void ProcessorQueue::cancel(int id) {
+	auto e = find(id);
+	if (!e) {
+		return;
+	}
+	if (e->state == QueueEntry::QUEUED) {
+		e->state = QueueEntry::CANCELLED;
+		e->job->deleteLater();
+		e->job = nullptr;
+		prune();
+		emit changed();
+	}
+	else if (e->state == QueueEntry::RUNNING) {
+		e->job->abort();
+	}
+}
+
+void ProcessorQueue::cancelAll() {
+	// Cancelling can prune the queue, so not while iterating it
+	QList<int> ids;
+	for (auto& e : queue) {
+		ids.append(e.id);
+	}
+	for (auto id : ids) {
+		cancel(id);
+	}
+}
+
+QueueEntry *ProcessorQueue::find(int id) {
+	for (auto& e : queue) {
+		if (e.id == id) {
+			return &e;
+		}
+	}
+	return nullptr;
+}
+
+QueueEntry *ProcessorQueue::find(QObject *job) {
+	for (auto& e : queue) {
+		if (e.job == job) {
+			return &e;
+		}
+	}
+	return nullptr;
+}
+
+// Starts queued jobs in order of priority, then age, for as long as the next one fits in the budget.
+// Smaller jobs further back are not let past a big one, so a big job can't be starved.
+void ProcessorQueue::schedule() {
+	QList<QueueEntry*> waiting;
+	for (auto& e : queue) {
+		if (e.state == QueueEntry::QUEUED) {
+			waiting.append(&e);
+		}
+	}
+	std::stable_sort(waiting.begin(), waiting.end(), [](const QueueEntry *a, const QueueEntry *b) {
+		return a->priority > b->priority;
+	});
+
+	auto free = max_workers - used();
+	for (auto e : waiting) {
+		// A job wanting more than the whole budget gets the whole budget
+		auto want = std::min(e->workers, max_workers);
+		if (want > free) {
+			break;
+		}
+		e->workers = want;
+		e->job->setWorkers(want);
+		e->state = QueueEntry::RUNNING;
+		free -= want;
+		QTimer::singleShot(0, e->job, SLOT(start()));
+	}
+}
+
+// Drops the oldest finished entries beyond MAX_FINISHED, so a long-lived queue doesn't grow without bound
+void ProcessorQueue::prune() {
+	int finished = 0;
+	for (auto& e : queue) {
+		if (e.state != QueueEntry::QUEUED && e.state != QueueEntry::RUNNING) {
+			++finished;
+		}
+	}
+	for (auto it = queue.begin() ; it != queue.end() && finished > MAX_FINISHED ; ) {
+		if (it->state != QueueEntry::QUEUED && it->state != QueueEntry::RUNNING) {
+			if (it->job) {
+				it->job->deleteLater();
+			}
+			it = queue.erase(it);
+			--finished;
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void ProcessorQueue::server_newConnection() {
+	while (auto sock = server.nextPendingConnection()) {
+		connect(sock, SIGNAL(readyRead()), this, SLOT(socket_readyRead()));
+		connect(sock, SIGNAL(disconnected()), sock, SLOT(deleteLater()));
+	}
+}
+
+// One request per line: "submit\t<params file>\t<priority>" answered with "queued\t<id>" or "error\t<reason>",
+// and "status" answered with one "job\t<id>\t<state>\t<priority>\t<workers>\t<params>" line per job and then "end"
+void ProcessorQueue::socket_readyRead() {
+	auto sock = qobject_cast<QLocalSocket*>(sender());
+	while (sock && sock->canReadLine()) {
+		auto ls = QString::fromUtf8(sock->readLine()).trimmed().split('\t');
+		if (ls.at(0) == "submit" && ls.size() >= 2) {
+			QString error;
+			auto id = -1;
+			if (ownsParams(sock, ls.at(1))) {
+				id = submit(ls.at(1), ls.value(2).toInt(), error);
+			}
+			else {
+				error = tr("%1 is not a file owned by the queue's user").arg(ls.at(1));
+			}
+			if (id > 0) {
+				sock->write(QString("queued\t%1\n").arg(id).toUtf8());
+			}
+			else {
+				sock->write(QString("error\t%1\n").arg(error).toUtf8());
+			}
+		}
+		else if (ls.at(0) == "status") {
+			static const char *states[] = {"queued", "running", "done", "failed", "cancelled"};
+			for (auto& e : queue) {
+				sock->write(QString("job\t%1\t%2\t%3\t%4\t%5\n").arg(e.id).arg(states[e.state]).arg(e.priority).arg(e.workers).arg(e.params).toUtf8());
+			}
+			sock->write("end\n");
+		}
+		else {
+			sock->write("error\tUnknown request\n");
+		}
+	}
+}
+
+void ProcessorQueue::job_log(const QString& line) {
+	if (auto e = find(sender())) {
+		e->last_log = line.trimmed();
+		emit changed();
+	}
+}
+
+void ProcessorQueue::job_done(int code) {
+	auto e = find(sender());
+	if (!e) {
+		return;
+	}
+	e->code = code;
+	if (code == ProcessorJob::EXIT_OK) {
+		e->state = QueueEntry::DONE;
+	}
+	else if (code == ProcessorJob::EXIT_ABORTED) {
+		e->state = QueueEntry::CANCELLED;
+	}
+	else {
+		e->state = QueueEntry::FAILED;
+	}
+	e->stats = e->job->stats();
+	e->job->deleteLater();
+	e->job = nullptr;
+	prune();
+	schedule();
+	emit changed();
+}
@@ -0,0 +1,94 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef PROCESSORQUEUE_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define PROCESSORQUEUE_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include "ProcessorJob.hpp"
+#include <QtCore>
+#include <QLocalServer>
+
+// A queued or running Processor job
+struct QueueEntry {
+	enum State {
+		QUEUED,
+		RUNNING,
+		DONE,
+		FAILED,
+		CANCELLED,
+	};
+
+	int id = 0;
+	QString params;
+	int priority = 0;
+	int workers = 1;
+	State state = QUEUED;
+	int code = 0;
+	QString last_log;
+	QDateTime submitted;
+	// Owned until the job finishes, when its last stats are kept and the job itself is deleted
+	ProcessorJob *job = nullptr;
+	ProcessorStats stats;
+};
+
+// Accepts params files over a local socket from any editor window and runs them in-process, highest priority first,
+// never running more CG-3 workers at once than the budget allows.
+class ProcessorQueue : public QObject {
+	Q_OBJECT
+
+public:
+	explicit ProcessorQueue(QObject *parent = nullptr);
+	~ProcessorQueue();
+
+	bool listen();
+	int submit(const QString& params, int priority, QString& error);
+	void setBudget(int);
+	int budget() const;
+	int used() const;
+	bool busy() const;
+	const QList<QueueEntry>& entries() const;
+	void setPriority(int id, int priority);
+	void cancel(int id);
+	void cancelAll();
+
+signals:
+	void changed();
+
+private slots:
+	void server_newConnection();
+	void socket_readyRead();
+	void job_log(const QString&);
+	void job_done(int);
+
+private:
+	QueueEntry *find(int id);
+	QueueEntry *find(QObject*);
+	void schedule();
+	void prune();
+
+	QLocalServer server;
+	QList<QueueEntry> queue;
+	int next_id;
+	int max_workers;
+};
+
+#endif // PROCESSORQUEUE_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -0,0 +1,593 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProcessorWorker.hpp"
+#include <algorithm>
+#include <cstring>
+#if defined(Q_OS_LINUX)
+	#include <unistd.h>
+#endif
+
+static const char STREAMCMD_FLUSH[] = "<STREAMCMD:FLUSH>\n";
+constexpr qint64 FEED_SLICE = 1 << 16;
+
+// Length of the longest prefix that ends on a line boundary, or all of it if there is no newline
+static qint64 wholeLines(const char *data, qint64 n) {
+	for (auto i = n ; i > 0 ; --i) {
+		if (data[i-1] == '\n') {
+			return i;
+		}
+	}
+	return n;
+}
+
+// Counts <STREAMCMD:FLUSH> lines in a block that starts on a line boundary, and notes whether the block ends with one
+static int countFlushes(const char *data, qint64 n, bool& ends) {
+	constexpr qint64 len = sizeof(STREAMCMD_FLUSH) - 2;
+	int count = 0;
+	ends = false;
+	for (qint64 i = 0 ; i + len <= n ; ++i) {
+		auto p = static_cast<const char*>(memchr(data + i, '<', n - i));
+		if (!p) {
+			break;
+		}
+		i = p - data;
+		if ((i == 0 || data[i-1] == '\n') && i + len <= n && memcmp(p, STREAMCMD_FLUSH, len) == 0) {
+			auto e = i + len;
+			if (e < n && data[e] == '\r') {
+				++e;
+			}
+			if (e == n || data[e] == '\n') {
+				++count;
+				ends = (e == n || e + 1 == n);
+			}
+		}
+	}
+	return count;
+}
+
+// Reads CPU time, peak RSS and I/O byte counts of a live child, where the OS makes that cheap to get
+static bool procUsage(qint64 pid, StageUsage& u) {
+#if defined(Q_OS_LINUX)
+	QFile stat(QString("/proc/%1/stat").arg(pid));
+	if (!stat.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	// Fields after the parenthesised command name, which may itself contain spaces
+	auto line = stat.readAll();
+	auto fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+	if (fields.size() < 13) {
+		return false;
+	}
+	static const qint64 ticks = sysconf(_SC_CLK_TCK);
+	u.cpu_ms = (fields[11].toLongLong() + fields[12].toLongLong()) * 1000 / ticks;
+
+	QFile status(QString("/proc/%1/status").arg(pid));
+	if (status.open(QIODevice::ReadOnly)) {
+		for (auto& l : status.readAll().split('\n')) {
+			if (l.startsWith("VmHWM:")) {
+				u.rss_kb = l.mid(6).trimmed().split(' ').front().toLongLong();
+				break;
+			}
+		}
+	}
+
+	QFile io(QString("/proc/%1/io").arg(pid));
+	if (io.open(QIODevice::ReadOnly)) {
+		for (auto& l : io.readAll().split('\n')) {
+			if (l.startsWith("rchar:")) {
+				u.read = l.mid(6).trimmed().toLongLong();
+			}
+			else if (l.startsWith("wchar:")) {
+				u.written = l.mid(6).trimmed().toLongLong();
+			}
+		}
+	}
+	return true;
+#else
+	Q_UNUSED(pid);
+	Q_UNUSED(u);
+	return false;
+#endif
+}
+
+ProcessorWorker::ProcessorWorker(QObject *parent, int id, const QFileInfoList& inputs, bool delimit, bool split) :
+	QObject(parent),
+	inputs(inputs),
+	feed_idx(0),
+	map(nullptr),
+	map_pos(0),
+	carry(0),
+	decoded_in(0),
+	input_buffer(32768, 0),
+	delimit(delimit),
+	split(split),
+	last_nl(true),
+	out_nl(true),
+	no_more(false),
+	closed(false),
+	stage_failed(false)
+{
+	if (id) {
+		prefix = tr("Worker %1: ").arg(id);
+	}
+}
+
+ProcessorWorker::~ProcessorWorker() {
+}
+
+// Plain commands are run directly, so each stage is its own process with its own environment, stderr and exit status.
+// Anything that needs a shell to mean what it says is still handed to one, as a single stage.
+// On Windows that's everything, as builtins like type and .bat or .cmd wrappers only run through cmd.
+static bool needsShell(const QString& command) {
+#if defined(Q_OS_WIN)
+	Q_UNUSED(command);
+	return true;
+#else
+	static const QRegularExpression rx("[|&;<>()$`*?~'\\[\\]{}%!]");
+	return command.contains(rx) || command.section(' ', 0, 0).contains('=');
+#endif
+}
+
+void ProcessorWorker::start(const QString& binary, const QStringList& args, const QStringList& pipes, const ProcessLimits& limits) {
+	process.reset(new LimitedProcess);
+	process->setLimits(limits);
+	connect(process.data(), SIGNAL(limitExceeded(QString)), this, SLOT(process_limitExceeded(QString)));
+	connect(process.data(), SIGNAL(started()), this, SLOT(process_started()));
+	connect(process.data(), SIGNAL(errorOccurred(QProcess::ProcessError)), this, SLOT(process_error(QProcess::ProcessError)));
+	connect(process.data(), SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(process_finished(int,QProcess::ExitStatus)));
+	connect(process.data(), SIGNAL(readyReadStandardOutput()), this, SLOT(process_readyReadStandardOutput()));
+	connect(process.data(), SIGNAL(readyReadStandardError()), this, SLOT(process_readyReadStandardError()));
+	process->setWorkingDirectory(QDir::tempPath());
+
+	for (auto& command : pipes) {
+		auto stage = new QProcess(this);
+		connect(stage, SIGNAL(started()), this, SLOT(pipe_started()));
+		connect(stage, SIGNAL(errorOccurred(QProcess::ProcessError)), this, SLOT(pipe_error(QProcess::ProcessError)));
+		connect(stage, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(pipe_finished(int,QProcess::ExitStatus)));
+		connect(stage, SIGNAL(readyReadStandardError()), this, SLOT(pipe_readyReadStandardError()));
+		stage->setWorkingDirectory(QDir::tempPath());
+		if (!stages.isEmpty()) {
+			stages.back()->setStandardOutputProcess(stage);
+		}
+		stages.append(stage);
+		stage_names.append(command);
+	}
+	if (!stages.isEmpty()) {
+		stages.back()->setStandardOutputProcess(process.data());
+	}
+	usage.fill(StageUsage(), stages.size() + 1);
+
+	auto p = head();
+	connect(p, SIGNAL(started()), this, SLOT(feed()));
+	connect(p, SIGNAL(bytesWritten(qint64)), this, SLOT(feed()));
+
+	for (int i=0 ; i<stages.size() ; ++i) {
+		auto& command = stage_names[i];
+		if (needsShell(command)) {
+			#if defined(Q_OS_WIN)
+			stages[i]->start("cmd", QStringList() << "/D" << "/Q" << "/C" << command);
+			#else
+			stages[i]->start("/bin/sh", QStringList() << "-c" << command);
+			#endif
+		}
+		else {
+			auto argv = QProcess::splitCommand(command);
+			auto program = argv.takeFirst();
+			stages[i]->start(program, argv);
+		}
+	}
+	process->start(binary, args);
+}
+
+// Where input goes in: the first pipe stage, or CG-3 itself
+QProcess *ProcessorWorker::head() const {
+	return stages.isEmpty() ? process.data() : stages.front();
+}
+
+int ProcessorWorker::stageOf(QObject *o) const {
+	return stages.indexOf(static_cast<QProcess*>(o));
+}
+
+void ProcessorWorker::enqueue(const Chunk& chunk) {
+	chunks.append(chunk);
+	chunks.back().left = chunk.length;
+	feed();
+}
+
+void ProcessorWorker::finish() {
+	no_more = true;
+	feed();
+}
+
+int ProcessorWorker::pending() const {
+	return chunks.size();
+}
+
+bool ProcessorWorker::isRunning() const {
+	return process && process->state() != QProcess::NotRunning;
+}
+
+// Refreshes and returns the usage of each pipe stage in order, followed by CG-3.
+// A finished process keeps the last numbers seen for it.
+const QVector<StageUsage>& ProcessorWorker::sample() {
+	for (int i=0 ; i<stages.size() ; ++i) {
+		if (stages[i]->state() == QProcess::Running) {
+			procUsage(stages[i]->processId(), usage[i]);
+		}
+	}
+	if (process && process->state() == QProcess::Running && !usage.isEmpty()) {
+		procUsage(process->processId(), usage.back());
+	}
+	return usage;
+}
+
+void ProcessorWorker::feed() {
+	auto p = head();
+	if (!p || closed || p->state() != QProcess::Running) {
+		return;
+	}
+
+	// Keep a few slices queued in the child's pipe, and refill from bytesWritten() as it drains
+	while (p->bytesToWrite() < FEED_SLICE*2) {
+		if (feed_idx >= chunks.size()) {
+			if (no_more) {
+				p->closeWriteChannel();
+				closed = true;
+			}
+			return;
+		}
+
+		auto& c = chunks[feed_idx];
+		// Compressed inputs are decompressed on their own thread, and read from it like a stream.
+		// FIFOs and other non-regular inputs are passed through that same thread, as opening or reading one can block.
+		auto threaded = (c.codec != CODEC_NONE || !inputs[c.file].isFile());
+		if (threaded && !decoder && c.left != 0) {
+			input.setFileName(inputs[c.file].filePath());
+			decoder.reset(new ProcessorDecoder(this, input.fileName(), c.codec));
+			connect(decoder.data(), SIGNAL(readyRead()), this, SLOT(feed()));
+			decoder->start();
+			decoded_in = 0;
+			carry = 0;
+			if (c.codec != CODEC_NONE) {
+				emit log(prefix + tr("Opened %1 compressed input file %2").arg(codecName(c.codec)).arg(input.fileName()));
+			}
+			else {
+				emit log(prefix + tr("Opened input stream %1").arg(input.fileName()));
+			}
+		}
+		else if (!threaded && !input.isOpen() && c.left != 0) {
+			input.setFileName(inputs[c.file].filePath());
+			if (!input.open(QIODevice::ReadOnly)) {
+				emit log(prefix + tr("Failed to open input file %1").arg(input.fileName()));
+				emit inputError(input.fileName());
+				c.left = 0;
+			}
+			else {
+				// Regular files are written to the child from a mapping, with no intermediate read buffer; QProcess still
+				// copies into its own write buffer. Files that can't be mapped are read here instead.
+				map_pos = 0;
+				carry = 0;
+				if (c.left > 0) {
+					map = input.map(c.offset, c.left);
+					if (!map && !input.seek(c.offset)) {
+						emit log(prefix + tr("Failed to seek in input file %1").arg(input.fileName()));
+						emit inputError(input.fileName());
+						c.left = 0;
+					}
+				}
+				if (c.offset == 0) {
+					emit log(prefix + tr("Opened input file %1").arg(input.fileName()));
+				}
+				else {
+					emit log(prefix + tr("Reading input file %1 from byte %2").arg(input.fileName()).arg(c.offset));
+				}
+			}
+		}
+
+		if (c.left != 0 && map) {
+			auto data = reinterpret_cast<const char*>(map + map_pos);
+			auto n = std::min(FEED_SLICE, c.left);
+			// Only ever write whole lines when delimiting, so flush markers in the input can be counted
+			if (delimit && c.left > n) {
+				n = wholeLines(data, n);
+			}
+			writeInput(c, data, n);
+			emit fed(c.file, n);
+			map_pos += n;
+			c.left -= n;
+		}
+		else if (c.left != 0) {
+			qint64 want = input_buffer.size() - carry;
+			if (c.left > 0) {
+				want = std::min(want, c.left);
+			}
+			auto n = decoder ? decoder->read(input_buffer.data() + carry, want) : input.read(input_buffer.data() + carry, want);
+			if (decoder) {
+				if (n == 0) {
+					// Nothing decompressed yet; readyRead() picks this up again
+					return;
+				}
+				if (n < 0 && !decoder->errorString().isEmpty()) {
+					if (c.codec != CODEC_NONE) {
+						emit log(prefix + tr("Failed to decompress input file %1: %2").arg(input.fileName()).arg(decoder->errorString()));
+					}
+					else {
+						emit log(prefix + tr("Failed to read input stream %1: %2").arg(input.fileName()).arg(decoder->errorString()));
+					}
+					emit inputError(input.fileName());
+				}
+				// Progress is counted in bytes read from the file, which for compressed inputs is what the input sizes are
+				auto consumed = decoder->consumed();
+				emit fed(c.file, consumed - decoded_in);
+				decoded_in = consumed;
+			}
+			else if (n > 0) {
+				emit fed(c.file, n);
+			}
+			if (n > 0) {
+				if (c.left > 0) {
+					c.left -= n;
+				}
+				auto total = carry + n;
+				auto w = (delimit && c.left != 0) ? wholeLines(input_buffer.constData(), total) : total;
+				writeInput(c, input_buffer.constData(), w);
+				carry = total - w;
+				if (carry) {
+					memmove(input_buffer.data(), input_buffer.constData() + w, carry);
+				}
+			}
+			else {
+				if (carry) {
+					writeInput(c, input_buffer.constData(), carry);
+					carry = 0;
+				}
+				c.left = 0;
+			}
+		}
+
+		if (c.left == 0) {
+			if (decoder) {
+				decoder.reset();
+				if (c.last) {
+					emit log(prefix + tr("Closed input file %1").arg(input.fileName()));
+				}
+			}
+			if (input.isOpen()) {
+				if (map) {
+					input.unmap(map);
+					map = nullptr;
+				}
+				input.close();
+				if (c.last) {
+					emit log(prefix + tr("Closed input file %1").arg(input.fileName()));
+				}
+			}
+			if (delimit && !c.ends_flush) {
+				if (!last_nl) {
+					p->write("\n");
+				}
+				p->write(STREAMCMD_FLUSH);
+				last_nl = true;
+				++c.flushes;
+				c.injected = true;
+			}
+			c.fed = true;
+			++feed_idx;
+		}
+	}
+}
+
+void ProcessorWorker::writeInput(Chunk& c, const char *data, qint64 n) {
+	if (n <= 0) {
+		return;
+	}
+	if (delimit) {
+		c.flushes += countFlushes(data, n, c.ends_flush);
+	}
+	auto p = head();
+	p->write(data, n);
+	last_nl = (data[n-1] == '\n');
+}
+
+void ProcessorWorker::process_started() {
+	emit logCG(prefix + tr("Launched CG-3"));
+}
+
+void ProcessorWorker::process_error(QProcess::ProcessError error) {
+	emit logCG(prefix + tr("CG-3 reported error %1").arg(error));
+	// A process that never started will never send finished() either
+	if (error == QProcess::FailedToStart) {
+		emit finished(false);
+	}
+}
+
+void ProcessorWorker::process_finished(int code, QProcess::ExitStatus status) {
+	emit logCG(prefix + tr("CG-3 exited with code %1 and status %2").arg(code).arg(status));
+
+	process_readyReadStandardOutput();
+	if (!out_tail.isEmpty() && !chunks.isEmpty()) {
+		emit output(chunks.front().seq, out_tail, false);
+		out_tail.clear();
+	}
+
+	usage.back().exit_code = code;
+	usage.back().crashed = (status != QProcess::NormalExit);
+
+	// A failed pipe stage means CG-3 saw truncated input, even if it was happy with it
+	bool ok = (code == 0 && status == QProcess::NormalExit && !stage_failed);
+	if (!delimit) {
+		// Undelimited output all went to the first chunk, so the rest are trivially done
+		while (!chunks.isEmpty()) {
+			emit output(chunks.front().seq, QByteArray(), true);
+			chunks.pop_front();
+		}
+	}
+	else if (!chunks.isEmpty()) {
+		emit log(prefix + tr("CG-3 exited before finishing chunk %1 of input file %2").arg(chunks.front().seq+1).arg(inputs[chunks.front().file].filePath()));
+		ok = false;
+	}
+
+	emit finished(ok);
+}
+
+void ProcessorWorker::process_readyReadStandardOutput() {
+	auto data = process->readAllStandardOutput();
+	if (!delimit) {
+		if (!data.isEmpty() && !chunks.isEmpty()) {
+			emit output(chunks.front().seq, data, false);
+		}
+		return;
+	}
+
+	if (!out_tail.isEmpty()) {
+		data.prepend(out_tail);
+		out_tail.clear();
+	}
+	if (data.isEmpty()) {
+		return;
+	}
+
+	// A trailing partial line that could still become a marker is held back until the rest of it arrives
+	constexpr int len = sizeof(STREAMCMD_FLUSH) - 1;
+	auto tail = data.lastIndexOf('\n') + 1;
+	if (tail < data.size() && data.size() - tail < len && data.at(tail) == '<' && memcmp(data.constData() + tail, STREAMCMD_FLUSH, data.size() - tail) == 0) {
+		out_tail = data.mid(tail);
+		data.truncate(tail);
+	}
+
+	int from = 0;
+	for (int i = 0 ; !chunks.isEmpty() && (i = data.indexOf(STREAMCMD_FLUSH, i)) != -1 ; i += len) {
+		if (i == 0 ? !out_nl : data.at(i-1) != '\n') {
+			continue;
+		}
+		auto& c = chunks.front();
+		++c.flushes_seen;
+		if (c.fed && c.flushes_seen == c.flushes) {
+			// Our own marker is dropped, except at the end of a split output file where it always was
+			auto keep = (!c.injected || (split && c.last)) ? i + len : i;
+			emit output(c.seq, data.mid(from, keep - from), true);
+			chunks.pop_front();
+			--feed_idx;
+			from = i + len;
+		}
+	}
+
+	if (from < data.size() && !chunks.isEmpty()) {
+		emit output(chunks.front().seq, from ? data.mid(from) : data, false);
+	}
+	if (!data.isEmpty()) {
+		out_nl = (data.at(data.size()-1) == '\n');
+	}
+}
+
+void ProcessorWorker::process_readyReadStandardError() {
+	process->setReadChannel(QProcess::StandardError);
+	QString line;
+	while (!(line = process->readLine(32768)).isEmpty()) {
+		emit logCG(prefix + line.trimmed());
+	}
+}
+
+// Says where in the input CG-3 was when it was killed: somewhere between the start of the chunk whose output
+// is still being read and the last byte of it fed so far
+void ProcessorWorker::process_limitExceeded(const QString& why) {
+	if (chunks.isEmpty()) {
+		emit log(prefix + tr("CG-3 was %1").arg(why));
+		return;
+	}
+	auto& c = chunks.front();
+	if (c.length >= 0) {
+		emit log(prefix + tr("CG-3 was %1 while processing input file %2 near bytes %3-%4").arg(why).arg(inputs[c.file].filePath()).arg(c.offset).arg(c.offset + c.length - c.left));
+	}
+	else {
+		emit log(prefix + tr("CG-3 was %1 while processing input file %2 after byte %3").arg(why).arg(inputs[c.file].filePath()).arg(c.offset));
+	}
+}
+
+QString ProcessorWorker::stageName(int i) const {
+	return tr("Stage %1 (%2)").arg(i+1).arg(stage_names[i].section(' ', 0, 0));
+}
+
+void ProcessorWorker::pipe_started() {
+	emit logPipe(prefix + tr("Launched %1").arg(stageName(stageOf(sender()))));
+}
+
+void ProcessorWorker::pipe_error(QProcess::ProcessError error) {
+	auto i = stageOf(sender());
+	emit logPipe(prefix + tr("%1 reported error %2").arg(stageName(i)).arg(error));
+	// With a stage missing, the rest of the chain would wait for input forever
+	if (error == QProcess::FailedToStart) {
+		stage_failed = true;
+		for (auto stage : stages) {
+			stage->kill();
+		}
+		process->kill();
+	}
+}
+
+void ProcessorWorker::pipe_finished(int code, QProcess::ExitStatus status) {
+	auto i = stageOf(sender());
+	emit logPipe(prefix + tr("%1 exited with code %2 and status %3").arg(stageName(i)).arg(code).arg(status));
+	usage[i].exit_code = code;
+	usage[i].crashed = (status != QProcess::NormalExit);
+	if (code != 0 || status != QProcess::NormalExit) {
+		stage_failed = true;
+		emit log(prefix + tr("%1 failed: %2").arg(stageName(i)).arg(stage_names[i]));
+	}
+}
+
+void ProcessorWorker::pipe_readyReadStandardError() {
+	auto i = stageOf(sender());
+	auto stage = stages[i];
+	stage->setReadChannel(QProcess::StandardError);
+	QString line;
+	while (!(line = stage->readLine(32768)).isEmpty()) {
+		emit logPipe(prefix + QString("%1: ").arg(i+1) + line.trimmed());
+	}
+}
+
+void ProcessorWorker::terminate() {
+	if (!stages.isEmpty()) {
+		emit log(prefix + tr("Sending friendly terminate signal to pipe..."));
+		for (auto stage : stages) {
+			stage->terminate();
+		}
+	}
+	if (process) {
+		emit log(prefix + tr("Sending friendly terminate signal to CG-3..."));
+		process->terminate();
+	}
+}
+
+void ProcessorWorker::kill() {
+	terminate();
+	if (!stages.isEmpty()) {
+		emit log(prefix + tr("Sending kill signal to pipe..."));
+		for (auto stage : stages) {
+			stage->kill();
+		}
+	}
+	if (process) {
+		emit log(prefix + tr("Sending kill signal to CG-3..."));
+		process->kill();
+	}
+}
@@ -0,0 +1,123 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef PROCESSORWORKER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define PROCESSORWORKER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include "ProcessLimits.hpp"
+#include "ProcessorCodec.hpp"
+#include <QtCore>
+
+// A slice of one input file. Chunks are numbered in input order, and their outputs are reassembled in that order.
+struct Chunk {
+	int seq = 0;
+	int file = 0;
+	qint64 offset = 0;
+	qint64 length = 0;
+	bool last = true;
+	Codec codec = CODEC_NONE;
+
+	// Feeding state, owned by the worker the chunk was dispatched to. A negative left means read until EOF.
+	qint64 left = 0;
+	int flushes = 0;
+	int flushes_seen = 0;
+	bool ends_flush = false;
+	bool injected = false;
+	bool fed = false;
+};
+
+// Resource use of one process in a worker's chain, as last sampled. Byte counts are all the process read and wrote, where the OS tells.
+struct StageUsage {
+	qint64 cpu_ms = 0;
+	qint64 rss_kb = 0;
+	qint64 read = 0;
+	qint64 written = 0;
+	int exit_code = -1;
+	bool crashed = false;
+};
+
+// One vislcg3 process, optionally behind a chain of pipe stages, fed a queue of chunks.
+// When delimiting, each chunk is terminated by <STREAMCMD:FLUSH> so its output can be told apart from the next chunk's.
+class ProcessorWorker : public QObject {
+	Q_OBJECT
+
+public:
+	ProcessorWorker(QObject *parent, int id, const QFileInfoList& inputs, bool delimit, bool split);
+	~ProcessorWorker();
+
+	void start(const QString& binary, const QStringList& args, const QStringList& pipes, const ProcessLimits& limits);
+	void enqueue(const Chunk&);
+	void finish();
+	int pending() const;
+	bool isRunning() const;
+	const QVector<StageUsage>& sample();
+	void terminate();
+	void kill();
+
+signals:
+	void log(const QString&);
+	void logCG(const QString&);
+	void logPipe(const QString&);
+	void inputError(const QString&);
+	void fed(int, qint64);
+	void output(int, const QByteArray&, bool);
+	void finished(bool);
+
+private slots:
+	void feed();
+	void process_started();
+	void process_error(QProcess::ProcessError);
+	void process_finished(int, QProcess::ExitStatus);
+	void process_readyReadStandardOutput();
+	void process_readyReadStandardError();
+	void process_limitExceeded(const QString&);
+	void pipe_started();
+	void pipe_error(QProcess::ProcessError);
+	void pipe_finished(int, QProcess::ExitStatus);
+	void pipe_readyReadStandardError();
+
+private:
+	void writeInput(Chunk&, const char*, qint64);
+	QProcess *head() const;
+	int stageOf(QObject*) const;
+	QString stageName(int) const;
+
+	QString prefix;
+	const QFileInfoList& inputs;
+	QList<Chunk> chunks;
+	int feed_idx;
+	QFile input;
+	QScopedPointer<ProcessorDecoder> decoder;
+	qint64 decoded_in;
+	uchar *map;
+	qint64 map_pos, carry;
+	QByteArray input_buffer;
+	QByteArray out_tail;
+	QScopedPointer<LimitedProcess> process;
+	QList<QProcess*> stages;
+	QStringList stage_names;
+	QVector<StageUsage> usage;
+	bool delimit, split;
+	bool last_nl, out_nl, no_more, closed, stage_failed;
+};
+
+#endif // PROCESSORWORKER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
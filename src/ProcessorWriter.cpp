@@ -0,0 +1,344 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ProcessorWriter.hpp"
+#include "ProcessorCodec.hpp"
+#include "Trace.hpp"
+#if defined(HAVE_ZLIB)
+	#include <zlib.h>
+#endif
+#if defined(HAVE_ZSTD)
+	#include <zstd.h>
+#endif
+#if defined(Q_OS_WIN)
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+// Requests in flight to the writer; past this they wait in the owner's overflow queue instead of blocking it
+constexpr size_t WRITER_QUEUE_OPS = 64;
+constexpr int WRITER_RETRY_MS = 20;
+constexpr qint64 COMPRESS_BLOCK = 1 << 17;
+
+static bool syncFile(QFile& file) {
+#if defined(Q_OS_WIN)
+	return _commit(file.handle()) == 0;
+#else
+	return ::fsync(file.handle()) == 0;
+#endif
+}
+
+// Streaming gzip or zstd compression into a file. end() closes the current gzip member or zstd frame, after which
+// the file is complete as it stands, and further writes start a new one that decompressors read as a continuation.
+class Compressor {
+public:
+	explicit Compressor(Codec codec) :
+		codec(codec),
+		buffer(COMPRESS_BLOCK, 0)
+	{
+		if (codec == CODEC_GZIP) {
+#if defined(HAVE_ZLIB)
+			if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+				error = "deflateInit2() failed";
+			}
+#else
+			error = "gzip support was not built in";
+#endif
+		}
+		else if (codec == CODEC_ZSTD) {
+#if defined(HAVE_ZSTD)
+			cs = ZSTD_createCCtx();
+#else
+			error = "zstd support was not built in";
+#endif
+		}
+	}
+
+	~Compressor() {
+#if defined(HAVE_ZLIB)
+		if (codec == CODEC_GZIP) {
+			deflateEnd(&zs);
+		}
+#endif
+#if defined(HAVE_ZSTD)
+		ZSTD_freeCCtx(cs);
+#endif
+	}
+
+	bool write(QFile& file, const char *data, qint64 n) {
+		open = true;
+		return run(file, data, n, false);
+	}
+
+	bool end(QFile& file) {
+		if (!open) {
+			return error.isEmpty();
+		}
+		open = false;
+		return run(file, nullptr, 0, true);
+	}
+
+	QString error;
+
+private:
+	bool run(QFile& file, const char *data, qint64 n, bool finish) {
+		if (!error.isEmpty()) {
+			return false;
+		}
+		auto out = [&](qint64 size) {
+			if (size > 0 && file.write(buffer.constData(), size) != size) {
+				error = file.errorString();
+			}
+		};
+		if (codec == CODEC_GZIP) {
+#if defined(HAVE_ZLIB)
+			zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+			zs.avail_in = static_cast<uInt>(n);
+			int rc = Z_OK;
+			do {
+				zs.next_out = reinterpret_cast<Bytef*>(buffer.data());
+				zs.avail_out = static_cast<uInt>(buffer.size());
+				rc = deflate(&zs, finish ? Z_FINISH : Z_NO_FLUSH);
+				out(buffer.size() - zs.avail_out);
+			} while (error.isEmpty() && (zs.avail_out == 0 || (finish && rc != Z_STREAM_END)));
+			if (finish) {
+				deflateReset(&zs);
+			}
+#endif
+		}
+		else if (codec == CODEC_ZSTD) {
+#if defined(HAVE_ZSTD)
+			ZSTD_inBuffer ib{data, static_cast<size_t>(n), 0};
+			size_t left = 0;
+			do {
+				ZSTD_outBuffer ob{buffer.data(), static_cast<size_t>(buffer.size()), 0};
+				left = ZSTD_compressStream2(cs, &ob, &ib, finish ? ZSTD_e_end : ZSTD_e_continue);
+				if (ZSTD_isError(left)) {
+					error = ZSTD_getErrorName(left);
+					break;
+				}
+				out(ob.pos);
+			} while (error.isEmpty() && (ib.pos < ib.size || (finish && left != 0)));
+#endif
+		}
+		Q_UNUSED(data);
+		Q_UNUSED(n);
+		Q_UNUSED(out);
+		return error.isEmpty();
+	}
+
+	Codec codec;
+	QByteArray buffer;
+	bool open = false;
+#if defined(HAVE_ZLIB)
+	z_stream zs{};
+#endif
+#if defined(HAVE_ZSTD)
+	ZSTD_CCtx *cs = nullptr;
+#endif
+};
+
+ProcessorWriter::ProcessorWriter(QObject *parent, Fsync fsync) :
+	QThread(parent),
+	queue(WRITER_QUEUE_OPS),
+	fsync(fsync)
+{
+	retry_timer.setInterval(WRITER_RETRY_MS);
+	connect(&retry_timer, SIGNAL(timeout()), this, SLOT(retry()));
+}
+
+ProcessorWriter::~ProcessorWriter() {
+	if (isRunning()) {
+		// Only reached when the owner is torn down mid-run; what's still in overflow can't be handed over without its event loop
+		overflow.clear();
+		Op op;
+		op.type = Op::OP_STOP;
+		while (!queue.push(op)) {
+			QThread::msleep(WRITER_RETRY_MS);
+		}
+		ready.release();
+		wait();
+	}
+}
+
+// Opens name for the following writes. A resume_size of 0 or more cuts an existing file back to that and appends, otherwise it's truncated.
+void ProcessorWriter::open(const QString& name, qint64 resume_size) {
+	Op op;
+	op.type = Op::OP_OPEN;
+	op.name = name;
+	op.value = resume_size;
+	post(op);
+}
+
+void ProcessorWriter::write(const QByteArray& data) {
+	Op op;
+	op.type = Op::OP_DATA;
+	op.data = data;
+	post(op);
+}
+
+// Makes everything written so far complete on disk, per the fsync policy, and reports the file's size with the ticket
+void ProcessorWriter::sync(int ticket) {
+	Op op;
+	op.type = Op::OP_SYNC;
+	op.value = ticket;
+	post(op);
+}
+
+void ProcessorWriter::close() {
+	Op op;
+	op.type = Op::OP_CLOSE;
+	post(op);
+}
+
+// Finishes all queued requests, then ends the thread
+void ProcessorWriter::stop() {
+	Op op;
+	op.type = Op::OP_STOP;
+	post(op);
+}
+
+void ProcessorWriter::post(Op& op) {
+	// Order must be kept, so once anything has overflowed, everything after it goes the same way
+	if (overflow.isEmpty() && queue.push(op)) {
+		ready.release();
+		return;
+	}
+	overflow.enqueue(std::move(op));
+	if (!retry_timer.isActive()) {
+		retry_timer.start();
+	}
+}
+
+void ProcessorWriter::retry() {
+	while (!overflow.isEmpty() && queue.push(overflow.head())) {
+		overflow.dequeue();
+		ready.release();
+	}
+	if (overflow.isEmpty()) {
+		retry_timer.stop();
+	}
+}
+
+void ProcessorWriter::run() {
+	QFile file;
+	QScopedPointer<Compressor> compressor;
+	bool broken = false;
+
+	auto report = [&](const QString& what) {
+		if (!broken) {
+			broken = true;
+			emit failed(QString("%1 %2: %3").arg(what).arg(file.fileName()).arg(compressor && !compressor->error.isEmpty() ? compressor->error : file.errorString()));
+		}
+	};
+	auto finish = [&]() {
+		if (compressor && !compressor->end(file)) {
+			report("Failed to compress");
+		}
+	};
+
+	forever {
+		ready.acquire();
+		Op op;
+		if (!queue.pop(op)) {
+			continue;
+		}
+
+		switch (op.type) {
+		case Op::OP_OPEN: {
+			file.setFileName(op.name);
+			compressor.reset();
+			broken = false;
+			QIODevice::OpenMode mode = QIODevice::WriteOnly|QIODevice::Unbuffered;
+			if (op.value >= 0) {
+				QFile::resize(op.name, op.value);
+				mode |= QIODevice::Append;
+			}
+			else {
+				mode |= QIODevice::Truncate;
+			}
+			if (!file.open(mode)) {
+				report("Failed to open output file");
+				break;
+			}
+			auto codec = codecForName(op.name);
+			if (codec != CODEC_NONE) {
+				compressor.reset(new Compressor(codec));
+			}
+			emit opened(op.name, file.size());
+			break;
+		}
+
+		case Op::OP_DATA: {
+			if (!file.isOpen() || broken) {
+				break;
+			}
+			TRACE_SPAN("write output");
+			if (compressor) {
+				if (!compressor->write(file, op.data.constData(), op.data.size())) {
+					report("Failed to compress");
+				}
+			}
+			else if (file.write(op.data) != op.data.size()) {
+				report("Failed to write");
+			}
+			break;
+		}
+
+		case Op::OP_SYNC: {
+			TRACE_SPAN("sync output");
+			// Only a size the file really has is reported, as the journal trusts everything up to it
+			if (!file.isOpen() || broken) {
+				report("Failed to sync");
+				break;
+			}
+			finish();
+			if (fsync == FSYNC_CHUNK && !syncFile(file)) {
+				report("Failed to sync");
+			}
+			if (!broken) {
+				emit synced(static_cast<int>(op.value), file.size());
+			}
+			break;
+		}
+
+		case Op::OP_CLOSE:
+			if (file.isOpen()) {
+				finish();
+				compressor.reset();
+				if (fsync != FSYNC_NONE && !syncFile(file)) {
+					report("Failed to sync");
+				}
+				file.close();
+				emit closed(file.fileName());
+			}
+			break;
+
+		case Op::OP_STOP:
+			if (file.isOpen()) {
+				finish();
+				file.close();
+			}
+			return;
+		}
+	}
+}
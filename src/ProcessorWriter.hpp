@@ -0,0 +1,123 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef PROCESSORWRITER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define PROCESSORWRITER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+#include <atomic>
+#include <vector>
+
+// Fixed-size ring between exactly one producer thread and one consumer thread, without locks
+template<typename T>
+class SpscQueue {
+public:
+	explicit SpscQueue(size_t capacity) :
+		ring(capacity + 1)
+	{
+	}
+
+	// Moves from v only if there was room
+	bool push(T& v) {
+		auto t = tail.load(std::memory_order_relaxed);
+		auto n = (t + 1) % ring.size();
+		if (n == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		ring[t] = std::move(v);
+		tail.store(n, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& v) {
+		auto h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		v = std::move(ring[h]);
+		head.store((h + 1) % ring.size(), std::memory_order_release);
+		return true;
+	}
+
+private:
+	std::vector<T> ring;
+	alignas(64) std::atomic<size_t> head{0};
+	alignas(64) std::atomic<size_t> tail{0};
+};
+
+// Does all output file handling on its own thread: opening, writing, compressing, syncing and closing.
+// The owner only ever queues requests, so draining CG-3 never waits on the disk; results come back as signals.
+class ProcessorWriter : public QThread {
+	Q_OBJECT
+
+public:
+	enum Fsync {
+		FSYNC_NONE,
+		FSYNC_CLOSE,
+		FSYNC_CHUNK,
+	};
+
+	ProcessorWriter(QObject *parent, Fsync fsync);
+	~ProcessorWriter();
+
+	void open(const QString& name, qint64 resume_size);
+	void write(const QByteArray&);
+	void sync(int ticket);
+	void close();
+	void stop();
+
+signals:
+	void opened(const QString&, qint64);
+	void synced(int, qint64);
+	void closed(const QString&);
+	void failed(const QString&);
+
+protected:
+	void run() override;
+
+private slots:
+	void retry();
+
+private:
+	struct Op {
+		enum Type {
+			OP_OPEN,
+			OP_DATA,
+			OP_SYNC,
+			OP_CLOSE,
+			OP_STOP,
+		} type = OP_DATA;
+		QString name;
+		QByteArray data;
+		qint64 value = 0;
+	};
+
+	void post(Op&);
+
+	SpscQueue<Op> queue;
+	QQueue<Op> overflow;
+	QSemaphore ready;
+	QTimer retry_timer;
+	Fsync fsync;
+};
+
+#endif // PROCESSORWRITER_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -0,0 +1,121 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "QueueClient.hpp"
+#include "inlines.hpp"
+
+// A freshly started queue gets this many tries, this far apart, to start listening
+constexpr int CONNECT_TRIES = 40;
+constexpr int CONNECT_RETRY_MS = 250;
+// Once the request is sent, how long to wait for the queue to answer
+constexpr int REPLY_TIMEOUT_MS = 30000;
+
+QueueClient::QueueClient(const QString& params, int priority, QObject *parent) :
+	QObject(parent),
+	params(params),
+	priority(priority),
+	tries(0),
+	spawned(false),
+	written(false),
+	finished(false)
+{
+	timer.setSingleShot(true);
+	connect(&sock, SIGNAL(connected()), this, SLOT(sock_connected()));
+	connect(&sock, SIGNAL(readyRead()), this, SLOT(sock_readyRead()));
+	connect(&sock, SIGNAL(stateChanged(QLocalSocket::LocalSocketState)), this, SLOT(sock_stateChanged(QLocalSocket::LocalSocketState)));
+	connect(&timer, SIGNAL(timeout()), this, SLOT(timer_timeout()));
+}
+
+void QueueClient::start() {
+	sock.connectToServer(queueServerName());
+}
+
+void QueueClient::sock_connected() {
+	sock.write(QString("submit\t%1\t%2\n").arg(params).arg(priority).toUtf8());
+	written = true;
+	timer.start(REPLY_TIMEOUT_MS);
+}
+
+void QueueClient::sock_readyRead() {
+	if (finished || !sock.canReadLine()) {
+		return;
+	}
+	auto reply = QString::fromUtf8(sock.readLine()).trimmed().split('\t');
+	if (reply.value(0) == "queued") {
+		emit queued(reply.value(1).toInt());
+	}
+	else {
+		emit refused(reply.value(1));
+	}
+	finish();
+}
+
+// A failed connect lands here as well as a dropped connection
+void QueueClient::sock_stateChanged(QLocalSocket::LocalSocketState state) {
+	if (finished || state != QLocalSocket::UnconnectedState) {
+		return;
+	}
+	if (written) {
+		// The answer may have come in with the hangup
+		if (sock.canReadLine()) {
+			sock_readyRead();
+			return;
+		}
+		emit lost(params);
+		finish();
+		return;
+	}
+	if (!spawned) {
+		spawned = true;
+		if (!QProcess::startDetached(QDir(QCoreApplication::applicationDirPath()).filePath("cg3processor"), QStringList() << "--queue")) {
+			emit unreachable(params);
+			finish();
+			return;
+		}
+	}
+	if (++tries >= CONNECT_TRIES) {
+		emit unreachable(params);
+		finish();
+		return;
+	}
+	timer.start(CONNECT_RETRY_MS);
+}
+
+void QueueClient::timer_timeout() {
+	if (finished) {
+		return;
+	}
+	if (written) {
+		emit lost(params);
+		finish();
+		return;
+	}
+	sock.abort();
+	sock.connectToServer(queueServerName());
+}
+
+void QueueClient::finish() {
+	finished = true;
+	timer.stop();
+	sock.disconnect(this);
+	sock.abort();
+	deleteLater();
+}
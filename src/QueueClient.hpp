@@ -0,0 +1,65 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef QUEUECLIENT_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define QUEUECLIENT_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+#include <QLocalSocket>
+
+// Hands a params file to the cg3processor queue without blocking the event loop, starting the queue if it isn't running.
+// Exactly one of queued(), refused(), unreachable() or lost() is emitted, after which the client deletes itself.
+class QueueClient : public QObject {
+	Q_OBJECT
+
+public:
+	QueueClient(const QString& params, int priority, QObject *parent = nullptr);
+	void start();
+
+signals:
+	void queued(int id);
+	void refused(const QString& reason);
+	// Nothing was sent, so the job can safely be run some other way
+	void unreachable(const QString& params);
+	// The request was sent but never answered, so the job may or may not be queued
+	void lost(const QString& params);
+
+private slots:
+	void sock_connected();
+	void sock_readyRead();
+	void sock_stateChanged(QLocalSocket::LocalSocketState);
+	void timer_timeout();
+
+private:
+	void finish();
+
+	QLocalSocket sock;
+	QTimer timer;
+	QString params;
+	int priority;
+	int tries;
+	bool spawned;
+	bool written;
+	bool finished;
+};
+
+#endif // QUEUECLIENT_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -0,0 +1,162 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "QueueMonitor.hpp"
+#include "ui_QueueMonitor.h"
+#include "inlines.hpp"
+#include <algorithm>
+
+enum {
+	COL_ID,
+	COL_PARAMS,
+	COL_STATE,
+	COL_PRIORITY,
+	COL_WORKERS,
+	COL_PROGRESS,
+	COL_RATE_IN,
+	COL_RATE_OUT,
+	COL_COHORTS,
+	COL_LOG,
+	NUM_COLS,
+};
+
+QueueMonitor::QueueMonitor(ProcessorQueue& queue) :
+	ui(new Ui::QueueMonitor),
+	queue(queue)
+{
+	ui->setupUi(this);
+
+	ui->tblJobs->setColumnCount(NUM_COLS);
+	ui->tblJobs->setHorizontalHeaderLabels(QStringList() << tr("ID") << tr("Params") << tr("State") << tr("Priority") << tr("Workers") << tr("Progress") << tr("In") << tr("Out") << tr("Cohorts/s") << tr("Last Log"));
+	ui->tblJobs->horizontalHeader()->setStretchLastSection(true);
+	ui->tblJobs->verticalHeader()->hide();
+
+	ui->spnBudget->setMaximum(std::max(QThread::idealThreadCount() * 4, 64));
+	ui->spnBudget->setValue(queue.budget());
+
+	// Stats arrive once a second per running job, so several jobs would otherwise redraw the table several times a second
+	refresh_timer.setSingleShot(true);
+	refresh_timer.setInterval(250);
+	connect(&refresh_timer, SIGNAL(timeout()), this, SLOT(refresh()));
+	connect(&queue, SIGNAL(changed()), this, SLOT(queue_changed()));
+
+	setWindowTitle(tr("Job Queue - CG-3 IDE Processor"));
+	refresh();
+}
+
+QueueMonitor::~QueueMonitor() {
+}
+
+void QueueMonitor::closeEvent(QCloseEvent *event) {
+	if (queue.busy()) {
+		auto rv = QMessageBox::question(this, tr("Jobs still running"), tr("Closing the queue cancels all queued and running jobs. Close anyway?"), QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+		if (rv != QMessageBox::Yes) {
+			event->ignore();
+			return;
+		}
+		queue.cancelAll();
+	}
+	QWidget::closeEvent(event);
+}
+
+int QueueMonitor::selectedId() const {
+	auto row = ui->tblJobs->currentRow();
+	if (row < 0) {
+		return 0;
+	}
+	return ui->tblJobs->item(row, COL_ID)->text().toInt();
+}
+
+void QueueMonitor::adjustPriority(int delta) {
+	auto id = selectedId();
+	for (auto& e : queue.entries()) {
+		if (e.id == id) {
+			queue.setPriority(id, e.priority + delta);
+			break;
+		}
+	}
+}
+
+void QueueMonitor::on_btnRaise_clicked(bool) {
+	adjustPriority(1);
+}
+
+void QueueMonitor::on_btnLower_clicked(bool) {
+	adjustPriority(-1);
+}
+
+void QueueMonitor::on_btnCancel_clicked(bool) {
+	if (auto id = selectedId()) {
+		queue.cancel(id);
+	}
+}
+
+void QueueMonitor::on_spnBudget_valueChanged(int n) {
+	QSettings settings;
+	settingSetOrDef(settings, "queue/workers", QThread::idealThreadCount(), n);
+	queue.setBudget(n);
+}
+
+void QueueMonitor::queue_changed() {
+	if (!refresh_timer.isActive()) {
+		refresh_timer.start();
+	}
+}
+
+void QueueMonitor::refresh() {
+	static const char *states[] = {QT_TR_NOOP("Queued"), QT_TR_NOOP("Running"), QT_TR_NOOP("Done"), QT_TR_NOOP("Failed"), QT_TR_NOOP("Cancelled")};
+
+	auto id = selectedId();
+	auto& entries = queue.entries();
+	ui->tblJobs->setRowCount(entries.size());
+	for (int row=0 ; row<entries.size() ; ++row) {
+		auto& e = entries[row];
+		QStringList cols;
+		cols << QString::number(e.id) << QFileInfo(e.params).fileName() << tr(states[e.state]) << QString::number(e.priority) << QString::number(e.workers);
+		if (e.state != QueueEntry::QUEUED) {
+			auto& st = e.job ? e.job->stats() : e.stats;
+			auto pct = st.bytes_total > 0 ? QString("%1%").arg(st.bytes_in * 100 / st.bytes_total) : QString("?");
+			cols << tr("%1, ETA %2").arg(pct).arg(formatTime(st.eta_ms)) << formatBytes(st.rate_in) + "/s" << formatBytes(st.rate_out) + "/s" << QString::number(st.rate_cohorts, 'f', 0);
+		}
+		else {
+			cols << "" << "" << "" << "";
+		}
+		cols << e.last_log;
+
+		for (int col=0 ; col<NUM_COLS ; ++col) {
+			auto item = ui->tblJobs->item(row, col);
+			if (!item) {
+				item = new QTableWidgetItem;
+				item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+				ui->tblJobs->setItem(row, col, item);
+			}
+			item->setText(cols[col]);
+			if (col == COL_PARAMS) {
+				item->setToolTip(e.params);
+			}
+		}
+		if (e.id == id) {
+			ui->tblJobs->setCurrentCell(row, ui->tblJobs->currentColumn());
+		}
+	}
+
+	ui->lblUsed->setText(tr("%1 of %2 workers in use").arg(queue.used()).arg(queue.budget()));
+}
@@ -0,0 +1,120 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Trace.hpp"
+
+namespace {
+	struct TraceEvent {
+		const char *name;
+		qint64 start, duration;
+		int tid;
+		QString detail;
+	};
+
+	// Enough for a long session with everything traced, without letting a forgotten trace eat all memory
+	constexpr int MAX_EVENTS = 1000000;
+
+	QMutex mutex;
+	QVector<TraceEvent> events;
+	QHash<Qt::HANDLE,int> tids;
+	qint64 origin = 0;
+
+	// Small stable numbers read better in the viewer than raw thread handles
+	int threadId() {
+		auto h = QThread::currentThreadId();
+		auto it = tids.find(h);
+		if (it == tids.end()) {
+			it = tids.insert(h, tids.size() + 1);
+		}
+		return it.value();
+	}
+
+	QString jsonString(const QString& s) {
+		QString rv = s;
+		rv.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n").replace('\r', "\\r").replace('\t', "\\t");
+		return rv;
+	}
+}
+
+std::atomic<bool> Trace::on(false);
+
+void Trace::setEnabled(bool state) {
+	QMutexLocker lock(&mutex);
+	if (state && !origin) {
+		origin = now();
+	}
+	on.store(state, std::memory_order_relaxed);
+}
+
+// With the variable set to a file name, records from the start and writes the trace there on exit.
+// Each program has its own variable, so an editor and the processor it launches don't overwrite each other's trace.
+bool Trace::fromEnvironment(const char *var) {
+	auto file = qEnvironmentVariable(var);
+	if (file.isEmpty()) {
+		return false;
+	}
+	setEnabled(true);
+	QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, [file]() {
+		write(file);
+	});
+	return true;
+}
+
+void Trace::record(const char *name, qint64 start, const QString& detail) {
+	auto end = now();
+	QMutexLocker lock(&mutex);
+	if (events.size() >= MAX_EVENTS) {
+		return;
+	}
+	events.append(TraceEvent{name, start, end - start, threadId(), detail});
+}
+
+bool Trace::write(const QString& filename) {
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	QMutexLocker lock(&mutex);
+	auto pid = QCoreApplication::applicationPid();
+	QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out += QString("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%1,\"tid\":0,\"args\":{\"name\":\"%2\"}}").arg(pid).arg(jsonString(QCoreApplication::applicationName())).toUtf8();
+	for (auto& e : events) {
+		out += QString(",\n{\"name\":\"%1\",\"ph\":\"X\",\"ts\":%2,\"dur\":%3,\"pid\":%4,\"tid\":%5").arg(jsonString(QString::fromUtf8(e.name))).arg(e.start - origin).arg(e.duration).arg(pid).arg(e.tid).toUtf8();
+		if (!e.detail.isEmpty()) {
+			out += QString(",\"args\":{\"detail\":\"%1\"}").arg(jsonString(e.detail)).toUtf8();
+		}
+		out += '}';
+		if (out.size() >= 1024*1024) {
+			file.write(out);
+			out.clear();
+		}
+	}
+	out += "\n]}\n";
+	file.write(out);
+	return file.commit();
+}
+
+void Trace::clear() {
+	QMutexLocker lock(&mutex);
+	events.clear();
+	origin = on.load(std::memory_order_relaxed) ? now() : 0;
+}
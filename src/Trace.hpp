@@ -0,0 +1,86 @@
+/*
+* Copyright 2013-2024, GrammarSoft ApS
+* Developed by Tino Didriksen <mail@tinodidriksen.com> for GrammarSoft ApS (https://grammarsoft.com/)
+* Development funded by Tony Berber Sardinha (http://www2.lael.pucsp.br/~tony/), São Paulo Catholic University (http://pucsp.br/), CEPRIL (http://www2.lael.pucsp.br/corpora/), CNPq (http://cnpq.br/), FAPESP (http://fapesp.br/)
+*
+* This file is part of CG-3 IDE
+*
+* CG-3 IDE is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CG-3 IDE is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CG-3 IDE.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#ifndef TRACE_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+#define TRACE_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
+
+#include <QtCore>
+#include <atomic>
+#include <chrono>
+
+// Records where time goes as Chrome trace events, viewable in chrome://tracing or ui.perfetto.dev.
+// When not enabled, a span costs one relaxed atomic load.
+class Trace {
+public:
+	static bool enabled() {
+		return on.load(std::memory_order_relaxed);
+	}
+	static void setEnabled(bool);
+	static bool fromEnvironment(const char *var);
+
+	// Microseconds on a steady clock; only differences mean anything
+	static qint64 now() {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	// For phases that start in one slot and end in another
+	static void record(const char *name, qint64 start, const QString& detail = QString());
+
+	static bool write(const QString& filename);
+	static void clear();
+
+private:
+	static std::atomic<bool> on;
+};
+
+class TraceSpan {
+public:
+	explicit TraceSpan(const char *name)
+		: name(name)
+		, start(Trace::enabled() ? Trace::now() : -1)
+	{
+	}
+	~TraceSpan() {
+		if (start >= 0) {
+			Trace::record(name, start, detail);
+		}
+	}
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+	// Shown as an argument of the event, e.g. the file being worked on
+	void setDetail(const QString& d) {
+		if (start >= 0) {
+			detail = d;
+		}
+	}
+
+private:
+	const char *name;
+	qint64 start;
+	QString detail;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+
+#endif // TRACE_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
@@ -24,6 +24,8 @@
 #define INLINES_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
 
 #include <QtWidgets>
+#include <QLocalServer>
+#include <QLocalSocket>
 #include <QRandomGenerator>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 	#include <QtCore5Compat/QTextCodec>
@@ -78,17 +80,58 @@ inline void settingSetOrDef(QSettings& settings, const QString& key, const T& de
 	}
 }
 
-inline bool launchEditor(const QStringList& args = QStringList()) {
-	QString exe = QCoreApplication::applicationFilePath();
-	QFileInfo exi(exe);
-	if (exi.exists() && exi.isExecutable() && QProcess::startDetached(exe, args)) {
-		return true;
+inline QString formatBytes(double b) {
+	if (b >= 1024.0*1024*1024) {
+		return QString("%1 GiB").arg(b / (1024.0*1024*1024), 0, 'f', 2);
 	}
-	return false;
+	if (b >= 1024.0*1024) {
+		return QString("%1 MiB").arg(b / (1024.0*1024), 0, 'f', 1);
+	}
+	if (b >= 1024.0) {
+		return QString("%1 KiB").arg(b / 1024.0, 0, 'f', 1);
+	}
+	return QString("%1 B").arg(b, 0, 'f', 0);
 }
 
-inline bool launchEditor(const QString& arg) {
-	return launchEditor(QStringList() << arg);
+inline QString formatTime(qint64 ms) {
+	if (ms < 0) {
+		return "?";
+	}
+	auto s = ms / 1000;
+	if (s >= 3600) {
+		return QString("%1:%2:%3").arg(s / 3600).arg((s / 60) % 60, 2, 10, QChar('0')).arg(s % 60, 2, 10, QChar('0'));
+	}
+	return QString("%1:%2").arg(s / 60).arg(s % 60, 2, 10, QChar('0'));
+}
+
+// Per user, so one user's editor or queue never serves another's requests
+inline QString localServerName(const QString& prefix) {
+	auto user = qEnvironmentVariable("USER", qEnvironmentVariable("USERNAME"));
+	return prefix + "-" + user;
+}
+
+inline QString queueServerName() {
+	return localServerName("cg3processor-queue");
+}
+
+inline QString editorServerName() {
+	return localServerName("cg3ide");
+}
+
+// Listens on a socket only its own user can reach. Fails if something is already answering on that name.
+inline bool listenLocal(QLocalServer& server, const QString& name) {
+	server.setSocketOptions(QLocalServer::UserAccessOption);
+	if (server.listen(name)) {
+		return true;
+	}
+	// A process that crashed can leave its socket file behind, which only matters if nobody answers on it
+	QLocalSocket probe;
+	probe.connectToServer(name);
+	if (probe.waitForConnected(500)) {
+		return false;
+	}
+	QLocalServer::removeServer(name);
+	return server.listen(name);
 }
 
 inline void curGotoLine(QTextCursor& cur, int line=0) {
@@ -146,20 +189,8 @@ inline bool filePutContents(const QString& name, const QString& data) {
 	return true;
 }
 
-inline size_t queryCG3Version(const QString& filename) {
+inline size_t parseCG3Version(const QString& result) {
 	size_t ver = 0;
-	QProcess cg3p;
-	cg3p.setProcessChannelMode(QProcess::MergedChannels);
-	cg3p.start(filename, QStringList() << "--version");
-	if (!cg3p.waitForStarted()) {
-		return ver;
-	}
-
-	if (!cg3p.waitForFinished()) {
-		return ver;
-	}
-
-	QString result = cg3p.readAll();
 	QRegularExpression rx("version \\d+\\.\\d+\\.\\d+\\.(\\d+)");
 	QRegularExpressionMatch match;
 	if ((match = rx.match(result)).hasMatch()) {
@@ -168,78 +199,20 @@ inline size_t queryCG3Version(const QString& filename) {
 	return ver;
 }
 
-inline QString findLatestCG3() {
-	QSettings settings;
-
-	QProgressDialog progress;
-	progress.setLabelText("Detecting most recent CG-3 binary...");
-	progress.show();
-
-	QStringList paths;
-
-	if (settings.contains("cg3/binary")) {
-		paths.append(QFileInfo(settings.value("cg3/binary").toString()).dir().path());
-	}
-
-	#if defined(Q_OS_WIN)
-	paths.append(QCoreApplication::instance()->applicationDirPath());
-	paths.append(QCoreApplication::instance()->applicationDirPath() + "/cg3/win32");
-	#elif defined(Q_OS_MAC)
-	paths.append(QCoreApplication::instance()->applicationDirPath() + "/../Resources/CG-3");
-	#else
-	paths.append(QCoreApplication::instance()->applicationDirPath() + "/cg3/linux");
-	#endif
-
-	#if defined(Q_OS_WIN)
-	paths.append(QProcessEnvironment::systemEnvironment().value("PATH").split(';'));
-	#else
-	paths.append(QProcessEnvironment::systemEnvironment().value("PATH").split(':'));
-	paths.append("/usr/bin");
-	paths.append("/usr/local/bin");
-	paths.append("/opt/bin");
-	paths.append("/opt/local/bin");
-	paths.append(QDir::home().filePath("/bin"));
-	#endif
-
-	progress.setMaximum(paths.size());
-
-	QFileInfoList cg3s;
-	for (auto& path : paths) {
-		progress.setValue(progress.value()+1);
-
-		QDir cg3(path);
-		#if defined(Q_OS_WIN)
-		#define CG3_BINARY_NAME "vislcg3.exe"
-		#else
-		#define CG3_BINARY_NAME "vislcg3"
-		#endif
-		if (cg3.exists(CG3_BINARY_NAME)) {
-			progress.setLabelText("Trying " + cg3.filePath(CG3_BINARY_NAME));
-			QFileInfo exe(cg3.filePath(CG3_BINARY_NAME));
-			if (exe.isExecutable()) {
-				cg3s.append(exe);
-			}
-		}
+inline size_t queryCG3Version(const QString& filename) {
+	size_t ver = 0;
+	QProcess cg3p;
+	cg3p.setProcessChannelMode(QProcess::MergedChannels);
+	cg3p.start(filename, QStringList() << "--version");
+	if (!cg3p.waitForStarted()) {
+		return ver;
 	}
 
-	progress.setLabelText("Querying found CG-3 binaries for versions...");
-	progress.setValue(0);
-	progress.setMaximum(cg3s.size());
-
-	QFileInfo latest;
-	size_t vlatest = 0;
-	for (auto& cg3 : cg3s) {
-		progress.setValue(progress.value()+1);
-		progress.setLabelText("Querying " + cg3.filePath());
-
-		size_t ver = queryCG3Version(cg3.filePath());
-		if (ver > vlatest) {
-			latest = cg3;
-			vlatest = ver;
-		}
+	if (!cg3p.waitForFinished()) {
+		return ver;
 	}
 
-	return latest.filePath();
+	return parseCG3Version(cg3p.readAll());
 }
 
 inline bool ISSPACE(const QChar c_) {
@@ -20,6 +20,9 @@
 */
 
 #include "GrammarEditor.hpp"
+#include "CG3Detector.hpp"
+#include "EditorInstance.hpp"
+#include "Trace.hpp"
 #include "inlines.hpp"
 #include <QtGui>
 #include <ctime>
@@ -36,37 +39,82 @@ int main(int argc, char *argv[]) {
 
 	QSettings::setDefaultFormat(QSettings::IniFormat);
 	QSettings settings;
-
-	if (settings.value("cg3/autodetect", true).toBool()) {
-		settings.setValue("cg3/autodetect", true);
-
-		QString latest = findLatestCG3();
-		settings.remove("cg3/binary");
-		if (!latest.isEmpty()) {
-			settings.setValue("cg3/binary", latest);
-		}
-	}
+	Trace::fromEnvironment("CG3IDE_TRACE");
 
 	auto args = app.arguments();
 	args.pop_front();
 
-	if (args.empty()) {
-		auto w = new GrammarEditor;
-		w->show();
+	// Unless asked not to, hand the files to an already running editor and get out of the way
+	bool single = (args.removeAll("--new-instance") == 0);
+	if (single && EditorInstance::forward(args)) {
+		return 0;
 	}
-	else {
-		bool first = true;
-		for (auto& arg : args) {
-			if (first) {
-				auto w = new GrammarEditor;
-				w->show();
-				w->open(arg);
-				first = false;
+	EditorInstance instance;
+	if (single) {
+		instance.listen();
+	}
+
+	// Journals whose window went away without closing hold edits that were never saved
+	bool recovered = false;
+	{
+		TRACE_SPAN("recover journals");
+		for (auto& journal : EditJournal::orphans()) {
+			QString filename, text;
+			if (EditJournal::replay(journal, filename, text)) {
+				auto name = filename.isEmpty() ? QCoreApplication::tr("an untitled grammar") : filename;
+				auto rv = QMessageBox::question(nullptr, QCoreApplication::tr("Recover unsaved changes?"), QCoreApplication::tr("CG-3 IDE did not shut down cleanly while there were unsaved changes to %1. Do you want to recover them?").arg(name), QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+				if (rv == QMessageBox::Yes) {
+					auto w = new GrammarEditor;
+					w->setAttribute(Qt::WA_DeleteOnClose);
+					w->show();
+					w->recover(filename, text);
+					recovered = true;
+				}
 			}
-			else {
-				launchEditor(arg);
+			EditJournal::remove(journal);
+		}
+	}
+
+	{
+		TRACE_SPAN("open windows");
+		if (args.empty()) {
+			if (!recovered) {
+				EditorInstance::openWindow();
 			}
 		}
+		else {
+			for (auto& arg : args) {
+				EditorInstance::openWindow(arg);
+			}
+		}
+	}
+
+	// Detection happens once the windows are up; it only spawns processes for binaries it hasn't seen before
+	if (settings.value("cg3/autodetect", true).toBool()) {
+		settings.setValue("cg3/autodetect", true);
+
+		auto detector = new CG3Detector(&app);
+		QObject::connect(detector, &CG3Detector::detected, &app, [](const QString& latest) {
+			QSettings settings;
+			if (!settings.value("cg3/autodetect", true).toBool() || settings.value("cg3/binary").toString() == latest) {
+				return;
+			}
+			settings.remove("cg3/binary");
+			if (!latest.isEmpty()) {
+				settings.setValue("cg3/binary", latest);
+			}
+			for (auto w : QApplication::topLevelWidgets()) {
+				if (auto ge = qobject_cast<GrammarEditor*>(w)) {
+					ge->reOptions();
+				}
+			}
+		});
+		QObject::connect(detector, SIGNAL(finished()), detector, SLOT(deleteLater()));
+		QObject::connect(&app, &QCoreApplication::aboutToQuit, detector, [detector]() {
+			detector->requestInterruption();
+			detector->wait();
+		});
+		detector->start(QThread::LowPriority);
 	}
 
 	return app.exec();
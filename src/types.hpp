@@ -23,6 +23,7 @@
 #ifndef TYPES_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
 #define TYPES_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7
 
+#include "ProcessLimits.hpp"
 #include <QtWidgets>
 
 struct CGChecker {
@@ -30,7 +31,7 @@ struct CGChecker {
 	QString binGrammar;
 	QString inputText;
 	QString inputFile;
-	QScopedPointer<QProcess> process;
+	QScopedPointer<LimitedProcess> process;
 };
 
 #endif // TYPES_HPP_cc7194f1bd3a13d1dca4d5a1c31f83d81877a7f7